@@ -34,108 +34,13 @@
 // translate pin number to SC1A nomenclature and viceversa
 // we need to create this static const arrays so that we can assign the "normal arrays" to the correct one
 // depending on which ADC module we will be.
-/* channel2sc1aADCx converts a pin number to their value for the SC1A register, for the ADC0 and ADC1
-*  numbers with +ADC_SC1A_PIN_MUX (128) means those pins use mux a, the rest use mux b.
-*  numbers with +ADC_SC1A_PIN_DIFF (64) means it's also a differential pin (treated also in the channel2sc1a_diff_ADCx)
-*  For diff_table_ADCx, +ADC_SC1A_PIN_PGA means the pin can use PGA on that ADC
-*/
-
-///////// ADC0
-#if defined(ADC_TEENSY_3_0)
-const uint8_t ADC::channel2sc1aADC0[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 4, 0, 19, 3, 21, // 0-13, we treat them as A0-A13
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 4, // 14-23 (A0-A9)
-    31, 31, 31, 31, 31, 31, 31, 31, 31, 31, // 24-33
-    0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, 3+ADC_SC1A_PIN_DIFF, 21+ADC_SC1A_PIN_DIFF, // 34-37 (A10-A13)
-    26, 22, 23, 27, 29, 30 // 38-43: temp. sensor, VREF_OUT, A14, bandgap, VREFH, VREFL. A14 isn't connected to anything in Teensy 3.0.
-};
-#elif defined(ADC_TEENSY_3_1) // the only difference with 3.0 is that A13 is not connected to ADC0 and that T3.1 has PGA.
-const uint8_t ADC::channel2sc1aADC0[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 4, 0, 19, 3, 31, // 0-13, we treat them as A0-A13
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 4, // 14-23 (A0-A9)
-    31, 31, 31, 31, 31, 31, 31, 31, 31, 31, // 24-33
-    0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, 3+ADC_SC1A_PIN_DIFF, 31+ADC_SC1A_PIN_DIFF, // 34-37 (A10-A13)
-    26, 22, 23, 27, 29, 30 // 38-43: temp. sensor, VREF_OUT, A14, bandgap, VREFH, VREFL. A14 isn't connected to anything in Teensy 3.0.
-};
-#elif defined(ADC_TEENSY_LC)
-// Teensy LC
-const uint8_t ADC::channel2sc1aADC0[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 11, 0, 4+ADC_SC1A_PIN_MUX, 23, 31, // 0-13, we treat them as A0-A12 + A13= doesn't exist
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 11, // 14-23 (A0-A9)
-    0+ADC_SC1A_PIN_DIFF, 4+ADC_SC1A_PIN_MUX+ADC_SC1A_PIN_DIFF, 23, 31, 31, 31, 31, 31, 31, 31, // 24-33 ((A10-A12) + nothing), A11 uses mux a
-    31, 31, 31, 31, // 34-37 nothing
-    26, 27, 31, 27, 29, 30 // 38-43: temp. sensor, , , bandgap, VREFH, VREFL.
-};
-#elif defined(ADC_TEENSY_3_5)
-const uint8_t ADC::channel2sc1aADC0[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 4, 3, 31, 31, 31, // 0-13, we treat them as A0-A13
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 4, // 14-23 (A0-A9)
-    26, 27, 29, 30, 31, 31, 31, // 24-30: Temp_Sensor, bandgap, VREFH, VREFL.
-    31, 31, 17, 18,// 31-34 A12(ADC1), A13(ADC1), A14, A15
-    31, 31, 31, 31, 31, 31, 31, 31, 31, // 35-43
-    31, 31, 31, 31, 31, 31, 31, 31, 31, // 44-52
-    31, 31, 31, 31, 31, 31, 31, 31, 31, // 53-61
-    31, 31, 3+ADC_SC1A_PIN_DIFF, 31+ADC_SC1A_PIN_DIFF, 23, 31, 1, 31 // 62-69 64: A10, 65: A11 (NOT CONNECTED), 66: A21, 68: A25 (no diff)
-};
-#elif defined(ADC_TEENSY_3_6)
-const uint8_t ADC::channel2sc1aADC0[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 4, 3, 31, 31, 31, // 0-13, we treat them as A0-A13
-    5, 14, 8, 9, 13, 12, 6, 7, 15, 4, // 14-23 (A0-A9)
-    26, 27, 29, 30, 31, 31, 31, // 24-30: Temp_Sensor, bandgap, VREFH, VREFL.
-    31, 31, 17, 18,// 31-34 A12(ADC1), A13(ADC1), A14, A15
-    31, 31, 31, 31, 31, 31, 31, 31, 31, // 35-43
-    31, 31, 31, 31, 31, 31, 31, 31, 31, // 44-52
-    31, 31, 31, 31, 31, 31, 31, 31, 31, // 53-61
-    31, 31, 3+ADC_SC1A_PIN_DIFF, 31+ADC_SC1A_PIN_DIFF, 23, 31 // 62-67 64: A10, 65: A11 (NOT CONNECTED), 66: A21, 67: A22(ADC1)
-};
-#elif defined(ADC_TEENSY_4)
-const uint8_t ADC::channel2sc1aADC0[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    7, 8, 12, 11, 6, 5, 15, 0, 13, 14, 1, 2, 31, 31, // 0-13, we treat them as A0-A13
-    7, 8, 12, 11, 6, 5, 15, 0, 13, 14, // 14-23 (A0-A9)
-    1, 2, 31, 31 // A10, A11, A12, A13
-};
-#endif // defined
-
-///////// ADC1
-#if defined(ADC_TEENSY_3_1)
-const uint8_t ADC::channel2sc1aADC1[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    31, 31, 8, 9, 31, 31, 31, 31, 31, 31, 3, 31, 0, 19, // 0-13, we treat them as A0-A13
-    31, 31, 8, 9, 31, 31, 31, 31, 31, 31, // 14-23 (A0-A9)
-    31, 31,  // 24,25 are digital only pins
-    5+ADC_SC1A_PIN_MUX, 5, 4, 6, 7, 4+ADC_SC1A_PIN_MUX, 31, 31, // 26-33 26=5a, 27=5b, 28=4b, 29=6b, 30=7b, 31=4a, 32,33 are digital only
-    3+ADC_SC1A_PIN_DIFF, 31+ADC_SC1A_PIN_DIFF, 0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, // 34-37 (A10-A13) A11 isn't connected.
-    26, 18, 31, 27, 29, 30 // 38-43: temp. sensor, VREF_OUT, A14 (not connected), bandgap, VREFH, VREFL.
-};
-#elif defined(ADC_TEENSY_3_5)
-const uint8_t ADC::channel2sc1aADC1[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    31, 31, 8, 9, 31, 31, 31, 31, 31, 31, 31, 19, 14, 15, // 0-13, we treat them as A0-A13
-    31, 31, 8, 9, 31, 31, 31, 31, 31, 31, // 14-23 (A0-A9)
-    26, 27, 29, 30, 18, 31, 31,  // 24-30: Temp_Sensor, bandgap, VREFH, VREFL, VREF_OUT
-    14, 15, 31, 31, 4, 5, 6, 7, 17, // 31-39 A12-A20
-    31, 31, 31, 31, // 40-43
-    31, 31, 31, 31, 31, 10, 11, 31, 31, // 44-52, 49: A23, 50: A24
-    31, 31, 31, 31, 31, 31, 31, 31, 31, // 53-61
-    31, 31, 0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, 31, 23, 31, 1 // 62-69 64: A10, 65: A11, 67: A22, 69: A26 (not diff)
-};
-#elif defined(ADC_TEENSY_3_6)
-const uint8_t ADC::channel2sc1aADC1[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    31, 31, 8, 9, 31, 31, 31, 31, 31, 31, 31, 19, 14, 15, // 0-13, we treat them as A0-A13
-    31, 31, 8, 9, 31, 31, 31, 31, 31, 31, // 14-23 (A0-A9)
-    26, 27, 29, 30, 18, 31, 31,  // 24-30: Temp_Sensor, bandgap, VREFH, VREFL, VREF_OUT
-    14, 15, 31, 31, 4, 5, 6, 7, 17, // 31-39 A12-A20
-    31, 31, 31, 23, // 40-43: A10(ADC0), A11(ADC0), A21, A22
-    31, 31, 31, 31, 31, 10, 11, 31, 31, // 44-52, 49: A23, 50: A24
-    31, 31, 31, 31, 31, 31, 31, 31, 31, // 53-61
-    31, 31, 0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, 31, 23 // 61-67 64: A10, 65: A11, 66: A21(ADC0), 67: A22
-};
-#elif defined(ADC_TEENSY_4)
-const uint8_t ADC::channel2sc1aADC1[]= { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
-    7, 8, 12, 11, 6, 5, 15, 0, 13, 14, 31, 31, 3, 4, // 0-13, we treat them as A0-A13
-    7, 8, 12, 11, 6, 5, 15, 0, 13, 14, // 14-23 (A0-A9)
-    31, 31, 3, 4 // A10, A11, A12, A13
-};
+// channel2sc1aADCx are constexpr and defined in ADC.h, so they can be used at compile time (see ADC::analogRead<pin>()).
+constexpr uint8_t ADC::channel2sc1aADC0[];
+#ifdef ADC_DUAL_ADCS
+constexpr uint8_t ADC::channel2sc1aADC1[];
 #endif
 
+// For diff_table_ADCx, +ADC_SC1A_PIN_PGA means the pin can use PGA on that ADC
 #if defined(ADC_TEENSY_3_1) // Teensy 3.1
     const ADC_Module::ADC_NLIST ADC::diff_table_ADC0[]= {
         {A10, 0+ADC_SC1A_PIN_PGA}, {A12, 3}
@@ -220,16 +125,16 @@ const uint8_t ADC::sc1a2channelADC1[]= { // new version, gives directly the pin
 
 
 // Constructor
-ADC::ADC() : // awkward initialization  so there are no -Wreorder warnings
+ADC::ADC(bool init) : // awkward initialization  so there are no -Wreorder warnings
     #if ADC_DIFF_PAIRS > 0
-    adc0_obj(0, channel2sc1aADC0, diff_table_ADC0, ADC0_START)
+    adc0_obj(0, channel2sc1aADC0, diff_table_ADC0, ADC0_START, init)
     #ifdef ADC_DUAL_ADCS
-    , adc1_obj(1, channel2sc1aADC1, diff_table_ADC1, ADC1_START)
+    , adc1_obj(1, channel2sc1aADC1, diff_table_ADC1, ADC1_START, init)
     #endif
     #else
-    adc0_obj(0, channel2sc1aADC0, ADC0_START)
+    adc0_obj(0, channel2sc1aADC0, ADC0_START, init)
     #ifdef ADC_DUAL_ADCS
-    , adc1_obj(1, channel2sc1aADC1, ADC1_START)
+    , adc1_obj(1, channel2sc1aADC1, ADC1_START, init)
     #endif
     #endif
     {
@@ -239,11 +144,45 @@ ADC::ADC() : // awkward initialization  so there are no -Wreorder warnings
 }
 
 
+#ifdef ADC_DUAL_ADCS
+/* Choose the ADC that will have the result of a new conversion first, for a pin that both can read.
+*  ADCs that are streaming (continuous, hardware trigger or DMA) are only used if both are,
+*  if they would be free at the same time use the one with less workload.
+*/
+ADC_Module* ADC::leastBusyADC() {
+    const uint32_t wait0 = adc0->getExpectedWait();
+    const uint32_t wait1 = adc1->getExpectedWait();
+    if (wait0 != wait1) {
+        return (wait1 < wait0) ? adc1 : adc0;
+    }
+    return (adc0->num_measurements > adc1->num_measurements) ? adc1 : adc0;
+}
+#endif
+
+/* Initialize all ADCs and start their calibrations, the ADCs calibrate at the same time
+*/
+void ADC::begin() {
+    for(uint8_t i=0; i<num_ADCs; i++) {
+        adc[i]->begin();
+    }
+}
+
+/* Are all ADCs initialized and calibrated? It never waits
+*/
+bool ADC::isReady() {
+    bool ready = true;
+    for(uint8_t i=0; i<num_ADCs; i++) {
+        ready &= adc[i]->isReady(); // poll all of them, so they all start their next calibration
+    }
+    return ready;
+}
+
+
 /* Returns the analog value of the pin.
 * It waits until the value is read and then returns the result.
 * If a comparison has been set up and fails, it will return ADC_ERROR_VALUE.
 * This function is interrupt safe, so it will restore the adc to the state it was before being called
-* If more than one ADC exists, it will select the module with less workload, you can force a selection using
+* If more than one ADC exists, it will select the module that will finish first, you can force a selection using
 * adc_num. If you select ADC1 in Teensy 3.0 it will return ADC_ERROR_VALUE.
 */
 int ADC::analogRead(uint8_t pin, int8_t adc_num) {
@@ -258,11 +197,7 @@ int ADC::analogRead(uint8_t pin, int8_t adc_num) {
         bool adc1Pin = adc1->checkPin(pin);
 
         if(adc0Pin && adc1Pin)  { // Both ADCs
-            if( (adc0->num_measurements) > (adc1->num_measurements)) { // use the ADC with less workload
-                return adc1->analogRead(pin);
-            } else {
-                return adc0->analogRead(pin);
-            }
+            return leastBusyADC()->analogRead(pin); // use the ADC that will be free first
         } else if(adc0Pin) { // ADC0
             return adc0->analogRead(pin);
         } else if(adc1Pin) { // ADC1
@@ -284,6 +219,189 @@ int ADC::analogRead(uint8_t pin, int8_t adc_num) {
     #endif
 }
 
+/* Reads several pins, using both ADCs in parallel if possible.
+* The pins are split between the ADCs that can read them, balancing the number of conversions,
+* and each ADC converts its own pins one after the other while the other one does the same.
+*/
+bool ADC::analogReadBatch(const uint8_t *pins, int *results, uint8_t num_pins) {
+    #ifdef ADC_SINGLE_ADC
+    return adc0->analogReadBatch(pins, results, num_pins); // use ADC0
+    #else
+    // results holds the ADC of each pin until it's read, results can't be negative except ADC_ERROR_VALUE
+    const int USE_ADC0 = -1, USE_ADC1 = -2, USE_ANY = -3;
+
+    // first the pins that only one ADC can read
+    uint8_t num_adc0 = 0, num_adc1 = 0;
+    for(uint8_t i=0; i<num_pins; i++) {
+        const bool adc0Pin = adc0->checkPin(pins[i]);
+        const bool adc1Pin = adc1->checkPin(pins[i]);
+        if(adc0Pin && adc1Pin) {
+            results[i] = USE_ANY;
+        } else if(adc0Pin) {
+            results[i] = USE_ADC0;
+            num_adc0++;
+        } else if(adc1Pin) {
+            results[i] = USE_ADC1;
+            num_adc1++;
+        } else { // pin not valid in any ADC
+            adc0->fail_flag |= ADC_ERROR::WRONG_PIN;
+            adc1->fail_flag |= ADC_ERROR::WRONG_PIN;
+            return false;
+        }
+    }
+    // then share out the rest
+    for(uint8_t i=0; i<num_pins; i++) {
+        if(results[i] == USE_ANY) {
+            if(num_adc0 > num_adc1) {
+                results[i] = USE_ADC1;
+                num_adc1++;
+            } else {
+                results[i] = USE_ADC0;
+                num_adc0++;
+            }
+        }
+    }
+
+    // only the ADCs with pins are stopped, don't interrupt a more important stream in them
+    const bool use_adc0 = (num_adc0 > 0);
+    const bool use_adc1 = (num_adc1 > 0);
+    if(use_adc0 && !adc0->canPreempt(ADC_PRIORITY::NORMAL)) {
+        adc0->fail_flag |= ADC_ERROR::PREEMPT;
+        return false;
+    }
+    if(use_adc1 && !adc1->canPreempt(ADC_PRIORITY::NORMAL)) {
+        adc1->fail_flag |= ADC_ERROR::PREEMPT;
+        return false;
+    }
+
+    // check if we are interrupting a measurement or a stream, store its settings and stop it if so.
+    ADC_Module::ADC_Config old_adc0_config = {};
+    uint8_t wasADC0InUse = 0;
+    if(use_adc0) {
+        adc0->num_measurements++;
+        adc0->wait_for_cal();
+        wasADC0InUse = adc0->suspendStream(&old_adc0_config);
+        adc0->singleMode(); // no continuous mode
+    }
+    ADC_Module::ADC_Config old_adc1_config = {};
+    uint8_t wasADC1InUse = 0;
+    if(use_adc1) {
+        adc1->num_measurements++;
+        adc1->wait_for_cal();
+        wasADC1InUse = adc1->suspendStream(&old_adc1_config);
+        adc1->singleMode(); // no continuous mode
+    }
+
+    // index of the next pin of each ADC, num_pins if there are no more
+    auto next_pin = [&](uint8_t i, int use_adc) -> uint8_t {
+        while((i < num_pins) && (results[i] != use_adc)) {
+            i++;
+        }
+        return i;
+    };
+    uint8_t i0 = next_pin(0, USE_ADC0);
+    uint8_t i1 = next_pin(0, USE_ADC1);
+
+    // start both ADCs, then start the next pin of each one as soon as it has the result
+    if(i0 < num_pins) {
+        ADC_Module::startFast(ADC0_START, channel2sc1aADC0[pins[i0]], 0);
+    }
+    if(i1 < num_pins) {
+        ADC_Module::startFast(ADC1_START, channel2sc1aADC1[pins[i1]], 1);
+    }
+    while((i0 < num_pins) || (i1 < num_pins)) {
+        if(i0 < num_pins) {
+            const uint8_t next = next_pin(i0+1, USE_ADC0);
+            const int result = ADC_Module::waitFast(ADC0_START);
+            if(next < num_pins) {
+                ADC_Module::startFast(ADC0_START, channel2sc1aADC0[pins[next]], 0);
+            }
+            if(result == ADC_ERROR_VALUE) {
+                adc0->fail_flag |= ADC_ERROR::COMPARISON;
+                ADC_TRACE_EVENT(COMPARISON_FAILED, 0, 0);
+            }
+            results[i0] = result;
+            i0 = next;
+        }
+        if(i1 < num_pins) {
+            const uint8_t next = next_pin(i1+1, USE_ADC1);
+            const int result = ADC_Module::waitFast(ADC1_START);
+            if(next < num_pins) {
+                ADC_Module::startFast(ADC1_START, channel2sc1aADC1[pins[next]], 1);
+            }
+            if(result == ADC_ERROR_VALUE) {
+                adc1->fail_flag |= ADC_ERROR::COMPARISON;
+                ADC_TRACE_EVENT(COMPARISON_FAILED, 1, 0);
+            }
+            results[i1] = result;
+            i1 = next;
+        }
+    }
+
+    // if we interrupted a conversion, set it again
+    if (wasADC0InUse) {
+        adc0->resumeStream(&old_adc0_config);
+    }
+    if (wasADC1InUse) {
+        adc1->resumeStream(&old_adc1_config);
+    }
+
+    if (use_adc0) {
+        adc0->num_measurements--;
+    }
+    if (use_adc1) {
+        adc1->num_measurements--;
+    }
+
+    return true;
+    #endif
+}
+
+/* Prepares a pin to be read many times with little overhead.
+* If more than one ADC exists, it will use ADC0 if it can read the pin, you can force a selection using
+* adc_num.
+*/
+ADC_Module::PreparedChannel ADC::prepareChannel(uint8_t pin, int8_t adc_num) {
+    #ifdef ADC_SINGLE_ADC
+    return adc0->prepareChannel(pin); // use ADC0
+    #else
+    if( adc_num==-1 ) { // use no ADC in particular
+        if(!adc0->checkPin(pin) && adc1->checkPin(pin)) { // only ADC1 can read it
+            return adc1->prepareChannel(pin);
+        }
+        return adc0->prepareChannel(pin);
+    }
+    else if( adc_num==0 ) { // user wants ADC0
+        return adc0->prepareChannel(pin);
+    }
+    else if( adc_num==1 ){ // user wants ADC 1
+        return adc1->prepareChannel(pin);
+    }
+    adc0->fail_flag |= ADC_ERROR::OTHER;
+    return ADC_Module::PreparedChannel();
+    #endif
+}
+
+/* Save the calibration of all ADCs to the EEPROM, one after the other
+*/
+bool ADC::saveCalibration(int address) {
+    bool saved = true;
+    for(uint8_t i=0; i<num_ADCs; i++) {
+        saved &= adc[i]->saveCalibration(address + i*ADC_Module::calibrationEEPROMSize());
+    }
+    return saved;
+}
+
+/* Load the calibration of all ADCs from the EEPROM
+*/
+bool ADC::loadCalibration(int address) {
+    bool loaded = true;
+    for(uint8_t i=0; i<num_ADCs; i++) {
+        loaded &= adc[i]->loadCalibration(address + i*ADC_Module::calibrationEEPROMSize());
+    }
+    return loaded;
+}
+
 #if ADC_DIFF_PAIRS > 0
 /* Reads the differential analog value of two pins (pinP - pinN).
 * It waits until the value is read and then returns the result.
@@ -292,7 +410,7 @@ int ADC::analogRead(uint8_t pin, int8_t adc_num) {
 * \param pinN must be A11 (if pinP=A10) or A13 (if pinP=A12).
 * Other pins will return ADC_ERROR_VALUE.
 * This function is interrupt safe, so it will restore the adc to the state it was before being called
-* If more than one ADC exists, it will select the module with less workload, you can force a selection using
+* If more than one ADC exists, it will select the module that will finish first, you can force a selection using
 * adc_num. If you select ADC1 in Teensy 3.0 it will return ADC_ERROR_VALUE.
 */
 int ADC::analogReadDifferential(uint8_t pinP, uint8_t pinN, int8_t adc_num) {
@@ -308,11 +426,7 @@ int ADC::analogReadDifferential(uint8_t pinP, uint8_t pinN, int8_t adc_num) {
         bool adc1Pin = adc1->checkDifferentialPins(pinP, pinN);
 
         if(adc0Pin && adc1Pin)  { // Both ADCs
-            if( (adc0->num_measurements) > (adc1->num_measurements)) { // use the ADC with less workload
-                return adc1->analogReadDifferential(pinP, pinN);
-            } else {
-                return adc0->analogReadDifferential(pinP, pinN);
-            }
+            return leastBusyADC()->analogReadDifferential(pinP, pinN); // use the ADC that will be free first
         } else if(adc0Pin) { // ADC0
             return adc0->analogReadDifferential(pinP, pinN);
         } else if(adc1Pin) { // ADC1
@@ -355,11 +469,7 @@ bool ADC::startSingleRead(uint8_t pin, int8_t adc_num) {
 
         if(adc0Pin && adc1Pin)  { // Both ADCs
 
-            if( (adc0->num_measurements) > (adc1->num_measurements)) { // use the ADC with less workload
-                return adc1->startSingleRead(pin);
-            } else {
-                return adc0->startSingleRead(pin);
-            }
+            return leastBusyADC()->startSingleRead(pin); // use the ADC that will be free first
         } else if(adc0Pin) { // ADC0
             return adc0->startSingleRead(pin);
         } else if(adc1Pin) { // ADC1
@@ -402,11 +512,7 @@ bool ADC::startSingleDifferential(uint8_t pinP, uint8_t pinN, int8_t adc_num) {
         bool adc1Pin = adc1->checkDifferentialPins(pinP, pinN);
 
         if(adc0Pin && adc1Pin)  { // Both ADCs
-            if( (adc0->num_measurements) > (adc1->num_measurements)) { // use the ADC with less workload
-                return adc1->startSingleDifferential(pinP, pinN);
-            } else {
-                return adc0->startSingleDifferential(pinP, pinN);
-            }
+            return leastBusyADC()->startSingleDifferential(pinP, pinN); // use the ADC that will be free first
         } else if(adc0Pin) { // ADC0
             return adc0->startSingleDifferential(pinP, pinN);
         } else if(adc1Pin) { // ADC1
@@ -430,6 +536,41 @@ bool ADC::startSingleDifferential(uint8_t pinP, uint8_t pinN, int8_t adc_num) {
 #endif
 
 // Reads the analog value of a single conversion.
+// Starts an analog measurement on the pin and returns a handle to get the result later.
+/* If the pin is incorrect the handle isn't valid and its value is ADC_ERROR_VALUE
+*/
+ADC_Module::AsyncRead ADC::startRead(uint8_t pin, int8_t adc_num) {
+    #ifdef ADC_SINGLE_ADC
+    return adc0->startRead(pin); // use ADC0
+    #else
+    if( adc_num==-1 ) { // use no ADC in particular
+        // check which ADC can read the pin
+        bool adc0Pin = adc0->checkPin(pin);
+        bool adc1Pin = adc1->checkPin(pin);
+
+        if(adc0Pin && adc1Pin)  { // Both ADCs
+            return leastBusyADC()->startRead(pin); // use the ADC that will be free first
+        } else if(adc0Pin) { // ADC0
+            return adc0->startRead(pin);
+        } else if(adc1Pin) { // ADC1
+            return adc1->startRead(pin);
+        } else { // pin not valid in any ADC
+            adc0->fail_flag |= ADC_ERROR::WRONG_PIN;
+            adc1->fail_flag |= ADC_ERROR::WRONG_PIN;
+            return ADC_Module::AsyncRead();
+        }
+    }
+    else if( adc_num==0 ) { // user wants ADC0
+        return adc0->startRead(pin);
+    }
+    else if( adc_num==1 ){ // user wants ADC 1
+        return adc1->startRead(pin);
+    }
+    adc0->fail_flag |= ADC_ERROR::OTHER;
+    return ADC_Module::AsyncRead();
+    #endif
+}
+
 /* Set the conversion with with startSingleRead(pin) or startSingleDifferential(pinP, pinN).
 *   \return the converted value.
 */
@@ -460,11 +601,7 @@ bool ADC::startContinuous(uint8_t pin, int8_t adc_num) {
         bool adc1Pin = adc1->checkPin(pin);
 
         if(adc0Pin && adc1Pin)  { // Both ADCs
-            if( (adc0->num_measurements) > (adc1->num_measurements)) { // use the ADC with less workload
-                return adc1->startContinuous(pin);
-            } else {
-                return adc0->startContinuous(pin);
-            }
+            return leastBusyADC()->startContinuous(pin); // use the ADC that will be free first
         } else if(adc0Pin) { // ADC0
             return adc0->startContinuous(pin);
         } else if(adc1Pin) { // ADC1
@@ -505,11 +642,7 @@ bool ADC::startContinuousDifferential(uint8_t pinP, uint8_t pinN, int8_t adc_num
         bool adc1Pin = adc1->checkDifferentialPins(pinP, pinN);
 
         if(adc0Pin && adc1Pin)  { // Both ADCs
-            if( (adc0->num_measurements) > (adc1->num_measurements)) { // use the ADC with less workload
-                return adc1->startContinuousDifferential(pinP, pinN);
-            } else {
-                return adc0->startContinuousDifferential(pinP, pinN);
-            }
+            return leastBusyADC()->startContinuousDifferential(pinP, pinN); // use the ADC that will be free first
         } else if(adc0Pin) { // ADC0
             return adc0->startContinuousDifferential(pinP, pinN);
         } else if(adc1Pin) { // ADC1
@@ -596,19 +729,21 @@ ADC::Sync_result ADC::analogSynchronizedRead(uint8_t pin0, uint8_t pin1) {
     uint8_t wasADC0InUse = adc0->isConverting(); // is the ADC running now?
     if(wasADC0InUse) { // this means we're interrupting a conversion
         // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
+        ADC_DISABLE_IRQ();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc0->saveConfig(&old_adc0_config);
-        __enable_irq();
+        ADC_TRACE_EVENT(PREEMPT, 0, 0);
+        ADC_ENABLE_IRQ();
     }
     ADC_Module::ADC_Config old_adc1_config = {};
     uint8_t wasADC1InUse = adc1->isConverting(); // is the ADC running now?
     if(wasADC1InUse) { // this means we're interrupting a conversion
         // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
+        ADC_DISABLE_IRQ();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc1->saveConfig(&old_adc1_config);
-        __enable_irq();
+        ADC_TRACE_EVENT(PREEMPT, 1, 0);
+        ADC_ENABLE_IRQ();
     }
 
     // no continuous mode
@@ -626,28 +761,32 @@ ADC::Sync_result ADC::analogSynchronizedRead(uint8_t pin0, uint8_t pin1) {
     }
 
 
-    __disable_irq(); // make sure nothing interrupts this part
+    ADC_DISABLE_IRQ(); // make sure nothing interrupts this part
     if ( adc0->isComplete() ) { // conversion succeded
-        res.result_adc0 = adc0->readSingle();
+        res.result_adc0 = adc0->analogReadContinuous();
     } else { // comparison was false
         adc0->fail_flag |= ADC_ERROR::COMPARISON;
+        ADC_TRACE_EVENT(COMPARISON_FAILED, 0, 0);
     }
     if ( adc1->isComplete() ) { // conversion succeded
-        res.result_adc1 = adc1->readSingle();
+        res.result_adc1 = adc1->analogReadContinuous();
     } else { // comparison was false
         adc1->fail_flag |= ADC_ERROR::COMPARISON;
+        ADC_TRACE_EVENT(COMPARISON_FAILED, 1, 0);
     }
-    __enable_irq();
+    ADC_ENABLE_IRQ();
 
 
     // if we interrupted a conversion, set it again
     if (wasADC0InUse) {
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc0->loadConfig(&old_adc0_config);
+        ADC_TRACE_EVENT(RESUME, 0, 0);
     }
     if (wasADC1InUse) {
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc1->loadConfig(&old_adc1_config);
+        ADC_TRACE_EVENT(RESUME, 1, 0);
     }
 
     //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
@@ -683,19 +822,21 @@ ADC::Sync_result ADC::analogSynchronizedReadDifferential(uint8_t pin0P, uint8_t
     uint8_t wasADC0InUse = adc0->isConverting(); // is the ADC running now?
     if(wasADC0InUse) { // this means we're interrupting a conversion
         // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
+        ADC_DISABLE_IRQ();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc0->saveConfig(&old_adc0_config);
-        __enable_irq();
+        ADC_TRACE_EVENT(PREEMPT, 0, 0);
+        ADC_ENABLE_IRQ();
     }
     ADC_Module::ADC_Config old_adc1_config = {};
     uint8_t wasADC1InUse = adc1->isConverting(); // is the ADC running now?
     if(wasADC1InUse) { // this means we're interrupting a conversion
         // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
+        ADC_DISABLE_IRQ();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc1->saveConfig(&old_adc1_config);
-        __enable_irq();
+        ADC_TRACE_EVENT(PREEMPT, 1, 0);
+        ADC_ENABLE_IRQ();
     }
 
     // no continuous mode
@@ -711,34 +852,38 @@ ADC::Sync_result ADC::analogSynchronizedReadDifferential(uint8_t pin0P, uint8_t
         yield();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
     }
-    __disable_irq(); // make sure nothing interrupts this part
+    ADC_DISABLE_IRQ(); // make sure nothing interrupts this part
     if (adc0->isComplete()) { // conversion succeded
-        res.result_adc0 = adc0->readSingle();
+        res.result_adc0 = adc0->analogReadContinuous();
         if(resolution0==16) { // 16 bit differential is actually 15 bit + 1 bit sign
             res.result_adc0 *= 2; // multiply by 2 as if it were really 16 bits, so that getMaxValue gives a correct value.
         }
     } else { // comparison was false
         adc0->fail_flag |= ADC_ERROR::COMPARISON;
+        ADC_TRACE_EVENT(COMPARISON_FAILED, 0, 0);
     }
     if (adc1->isComplete()) { // conversion succeded
-        res.result_adc1 = adc1->readSingle();
+        res.result_adc1 = adc1->analogReadContinuous();
         if(resolution1==16) { // 16 bit differential is actually 15 bit + 1 bit sign
             res.result_adc1 *= 2; // multiply by 2 as if it were really 16 bits, so that getMaxValue gives a correct value.
         }
     } else { // comparison was false
         adc1->fail_flag |= ADC_ERROR::COMPARISON;
+        ADC_TRACE_EVENT(COMPARISON_FAILED, 1, 0);
     }
-    __enable_irq();
+    ADC_ENABLE_IRQ();
 
 
     // if we interrupted a conversion, set it again
     if (wasADC0InUse) {
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc0->loadConfig(&old_adc0_config);
+        ADC_TRACE_EVENT(RESUME, 0, 0);
     }
     if (wasADC1InUse) {
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc1->loadConfig(&old_adc1_config);
+        ADC_TRACE_EVENT(RESUME, 1, 0);
     }
 
     //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
@@ -769,18 +914,20 @@ bool ADC::startSynchronizedSingleRead(uint8_t pin0, uint8_t pin1) {
     adc0->adcWasInUse = adc0->isConverting(); // is the ADC running now?
     if(adc0->adcWasInUse) { // this means we're interrupting a conversion
         // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
+        ADC_DISABLE_IRQ();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc0->saveConfig(&adc0->adc_config);
-        __enable_irq();
+        ADC_TRACE_EVENT(PREEMPT, 0, 0);
+        ADC_ENABLE_IRQ();
     }
     adc1->adcWasInUse = adc1->isConverting(); // is the ADC running now?
     if(adc1->adcWasInUse) { // this means we're interrupting a conversion
         // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
+        ADC_DISABLE_IRQ();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc1->saveConfig(&adc1->adc_config);
-        __enable_irq();
+        ADC_TRACE_EVENT(PREEMPT, 1, 0);
+        ADC_ENABLE_IRQ();
     }
 
     // no continuous mode
@@ -821,18 +968,20 @@ bool ADC::startSynchronizedSingleDifferential(uint8_t pin0P, uint8_t pin0N, uint
     adc0->adcWasInUse = adc0->isConverting(); // is the ADC running now?
     if(adc0->adcWasInUse) { // this means we're interrupting a conversion
         // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
+        ADC_DISABLE_IRQ();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc0->saveConfig(&adc0->adc_config);
-        __enable_irq();
+        ADC_TRACE_EVENT(PREEMPT, 0, 0);
+        ADC_ENABLE_IRQ();
     }
     adc1->adcWasInUse = adc1->isConverting(); // is the ADC running now?
     if(adc1->adcWasInUse) { // this means we're interrupting a conversion
         // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
+        ADC_DISABLE_IRQ();
         //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
         adc1->saveConfig(&adc1->adc_config);
-        __enable_irq();
+        ADC_TRACE_EVENT(PREEMPT, 1, 0);
+        ADC_ENABLE_IRQ();
     }
 
     // no continuous mode
@@ -884,10 +1033,10 @@ bool ADC::startSynchronizedContinuous(uint8_t pin0, uint8_t pin1) {
     adc0->continuousMode();
     adc1->continuousMode();
 
-    __disable_irq(); // both measurements should have a maximum delay of an instruction time
+    ADC_DISABLE_IRQ(); // both measurements should have a maximum delay of an instruction time
     adc0->startReadFast(pin0);
     adc1->startReadFast(pin1);
-    __enable_irq();
+    ADC_ENABLE_IRQ();
 
     return true;
 }
@@ -912,10 +1061,10 @@ bool ADC::startSynchronizedContinuousDifferential(uint8_t pin0P, uint8_t pin0N,
     adc0->continuousMode();
     adc1->continuousMode();
 
-    __disable_irq();
+    ADC_DISABLE_IRQ();
     adc0->startDifferentialFast(pin0P, pin0N);
     adc1->startDifferentialFast(pin1P, pin1N);
-    __enable_irq();
+    ADC_ENABLE_IRQ();
 
 
     return true;
@@ -939,4 +1088,45 @@ void ADC::stopSynchronizedContinuous() {
     adc1->stopContinuous();
 }
 
+#ifdef ADC_USE_TIMER
+// Starts conversions in both ADCs triggered by the same timer edge
+bool ADC::startSynchronizedTimer(uint8_t pin0, uint8_t pin1, uint32_t freq) {
+    // check pins
+    if ( !adc0->checkPin(pin0) ) {
+        adc0->fail_flag |= ADC_ERROR::WRONG_PIN;
+        return false;
+    }
+    if ( !adc1->checkPin(pin1) ) {
+        adc1->fail_flag |= ADC_ERROR::WRONG_PIN;
+        return false;
+    }
+
+    stopSynchronizedTimer();
+
+    adc0->wait_for_cal();
+    adc1->wait_for_cal();
+
+    // with the hardware trigger selecting the pins doesn't start a conversion,
+    // don't use startSingleRead: it would stop the trigger and the DMA (initSynchronized) of the stream
+    adc0->setHardwareTrigger();
+    adc1->setHardwareTrigger();
+    adc0->singleMode();
+    adc1->singleMode();
+    adc0->startReadFast(pin0);
+    adc1->startReadFast(pin1);
+
+    #if defined(ADC_USE_PDB)
+    return adc0->startSynchronizedPDB(freq, adc1);
+    #else
+    return adc0->startSynchronizedQuadTimer(freq, adc1);
+    #endif
+}
+
+// Stops the timer started by startSynchronizedTimer
+void ADC::stopSynchronizedTimer() {
+    adc0->stopTimer();
+    adc1->stopTimer();
+}
+#endif
+
 #endif
@@ -58,10 +58,6 @@ See the ADC class for all methods.
 // include ADC module class
 #include "ADC_Module.h"
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
 /** Class ADC: Controls the Teensy 3.x, 4 ADC
 *
 */
@@ -79,11 +75,31 @@ class ADC
         //! Number of ADC objects
         const uint8_t num_ADCs = ADC_NUM_ADCS;
 
+        #ifdef ADC_DUAL_ADCS
+        //! Choose the ADC that will have the result of a new conversion first, see ADC_Module::getExpectedWait()
+        ADC_Module* leastBusyADC();
+        #endif
+
 
     public:
 
-        /** Default constructor */
-        ADC();
+        //! Default constructor
+        /** It initializes the ADCs and starts their calibrations, but it doesn't wait for them.
+        *   \param init set it to false to do this later with begin(), for example if the object is global.
+        */
+        ADC(bool init = true);
+
+        //! Initialize all ADCs and start their calibrations at the same time, see ADC_Module::begin()
+        /** It returns at once, poll isReady() to know when the calibrations are done, or just use the ADCs:
+        *   any function that needs the calibration waits for it.
+        *   Call it before any other function if the object was created with init = false.
+        */
+        void begin();
+
+        //! Are all ADCs initialized and calibrated? See ADC_Module::isReady()
+        /** \return true if all ADCs can be used without waiting for a calibration.
+        */
+        bool isReady();
 
 
         // create both adc objects
@@ -110,7 +126,8 @@ class ADC
         /** It waits until the value is read and then returns the result.
         * If a comparison has been set up and fails, it will return ADC_ERROR_VALUE.
         * This function is interrupt safe, so it will restore the adc to the state it was before being called
-        * If more than one ADC exists, it will select the module with less workload, you can force a selection using
+        * If more than one ADC exists, it will select the module that will finish first without stopping a stream
+        * of conversions (see ADC_Module::getExpectedWait()), you can force a selection using
         * adc_num. If you select ADC1 in Teensy 3.0 it will return ADC_ERROR_VALUE.
         *   \param pin can be any of the analog pins
         *   \param adc_num ADC_X ADC module
@@ -118,6 +135,87 @@ class ADC
         */
         int analogRead(uint8_t pin, int8_t adc_num = -1);
 
+        //! Reads several pins, using both ADCs in parallel if possible
+        /** Each pin is read by an ADC that can read it, the pins that both ADCs can read are shared out so that
+        *   both modules have a similar number of conversions, and both of them convert at the same time.
+        *   Each ADC starts its next conversion as soon as it has the previous result, see ADC_Module::analogReadBatch().
+        *   If a comparison has been set up and fails for a pin, its result is ADC_ERROR_VALUE.
+        *   This function is interrupt safe, so it will restore the adcs to the state they were before being called,
+        *   but the conversions don't raise the ADC interrupts.
+        *   \param pins array with the pins to read, in any order.
+        *   \param results array of num_pins values, results[i] is the value of pins[i].
+        *   \param num_pins number of pins.
+        *   \return true if all pins are valid, false otherwise (no pin is read and fail_flag is set).
+        */
+        bool analogReadBatch(const uint8_t *pins, int *results, uint8_t num_pins);
+
+        //! Prepares a pin to be read many times with little overhead, see ADC_Module::PreparedChannel
+        /** If more than one ADC exists, it will use ADC0 if it can read the pin, you can force a selection using
+        *   adc_num. Read the pin with PreparedChannel::read().
+        *   \param pin can be any of the analog pins
+        *   \param adc_num ADC_X ADC module
+        *   \return the prepared channel, check it with isValid().
+        */
+        ADC_Module::PreparedChannel prepareChannel(uint8_t pin, int8_t adc_num = -1);
+
+        //! Save the calibration of all ADCs to the EEPROM, see ADC_Module::saveCalibration()
+        /** Each ADC uses ADC_Module::calibrationEEPROMSize() bytes, one after the other.
+        *   \param address first byte of the EEPROM to use.
+        *   \return true if all ADCs saved their calibration.
+        */
+        bool saveCalibration(int address);
+
+        //! Load the calibration of all ADCs from the EEPROM, see ADC_Module::loadCalibration()
+        /** Call it at the beginning of setup() to skip the calibration of the ADCs after a reset.
+        *   The ADCs whose data isn't valid are calibrated as usual.
+        *   \param address first byte of the EEPROM used by saveCalibration().
+        *   \return true if all ADCs loaded their calibration.
+        */
+        bool loadCalibration(int address);
+
+        //! Returns the analog value of the pin, resolved at compile time
+        /** The ADC, SC1A value and mux of the pin are found at compile time, and an invalid pin doesn't compile.
+        *   Like ADC_Module::PreparedChannel::read() it only starts the conversion and waits for the result,
+        *   so the ADC must be idle, in single mode, with the software trigger (the default state) and calibrated
+        *   (any other conversion method waits for the calibration, or call ADC_Module::wait_for_cal()).
+        *   If the pin is valid in both ADCs it uses ADC0, you can force a selection using adc_num.
+        *   Example: int value = adc->analogRead<A3>();
+        *   \tparam pin can be any of the analog pins
+        *   \tparam adc_num ADC_X ADC module
+        *   \return the value of the pin, or ADC_ERROR_VALUE if a comparison fails.
+        */
+        template<uint8_t pin, int8_t adc_num = -1>
+        __attribute__((always_inline)) static int analogRead() {
+            constexpr int8_t module = (adc_num == -1) ? (isValidPin(pin, 0) ? 0 : 1) : adc_num;
+            static_assert(isValidPin(pin, module), "analogRead<pin>(): the pin is not valid for the ADC");
+            return ADC_Module::readFast((module == 0) ? ADC0_START : ADC1_START, getSC1A(pin, module), module);
+        }
+
+        //! Translate the pin number to the SC1A value of the ADC (at compile time if possible)
+        /**
+        *   \param pin pin number.
+        *   \param adc_num ADC_X ADC module.
+        *   \return the value of channel2sc1aADCx, ADC_SC1A_PIN_INVALID if the pin or the ADC don't exist.
+        */
+        static constexpr uint8_t getSC1A(uint8_t pin, int8_t adc_num) {
+            #ifdef ADC_DUAL_ADCS
+            return ((pin > ADC_MAX_PIN) || (adc_num < 0) || (adc_num > 1)) ? ADC_SC1A_PIN_INVALID :
+                   (adc_num ? channel2sc1aADC1[pin] : channel2sc1aADC0[pin]);
+            #else
+            return ((pin > ADC_MAX_PIN) || (adc_num != 0)) ? ADC_SC1A_PIN_INVALID : channel2sc1aADC0[pin];
+            #endif
+        }
+
+        //! Check whether the pin is a valid analog pin for the ADC (at compile time if possible)
+        /**
+        *   \param pin pin number.
+        *   \param adc_num ADC_X ADC module.
+        *   \return true if the pin is valid, false otherwise.
+        */
+        static constexpr bool isValidPin(uint8_t pin, int8_t adc_num) {
+            return (getSC1A(pin, adc_num)&ADC_SC1A_CHANNELS) != ADC_SC1A_PIN_INVALID;
+        }
+
         //! Returns the analog value of the special internal source, such as the temperature sensor.
         /** It calls analogRead(uint8_t pin) internally, with the correct value for the pin for all boards.
         *   Possible values:
@@ -138,7 +236,8 @@ class ADC
         //! Reads the differential analog value of two pins (pinP - pinN).
         /** It waits until the value is read and then returns the result.
         * This function is interrupt safe, so it will restore the adc to the state it was before being called
-        * If more than one ADC exists, it will select the module with less workload, you can force a selection using
+        * If more than one ADC exists, it will select the module that will finish first without stopping a stream
+        * of conversions (see ADC_Module::getExpectedWait()), you can force a selection using
         * adc_num
         *   \param pinP must be A10 or A12.
         *   \param pinN must be A11 (if pinP=A10) or A13 (if pinP=A12).
@@ -180,6 +279,14 @@ class ADC
         */
         int readSingle(int8_t adc_num = -1);
 
+        //! Starts an analog measurement on the pin and returns a handle to get the result later.
+        /** Poll the handle with ready() and get the value with get(), see ADC_Module::AsyncRead.
+        *   \param pin can be any of the analog pins
+        *   \param adc_num ADC_X ADC module
+        *   \return the handle, it's not valid if the pin isn't.
+        */
+        ADC_Module::AsyncRead startRead(uint8_t pin, int8_t adc_num = -1);
+
 
 
         ///////////// CONTINUOUS CONVERSION METHODS ////////////
@@ -341,6 +448,26 @@ class ADC
         //! Stops synchronous continuous conversion
         void stopSynchronizedContinuous();
 
+        #ifdef ADC_USE_TIMER
+        ///////////// SYNCHRONIZED TIMER METHODS ////////////
+
+        //! Starts conversions in both ADCs triggered by the same timer edge
+        /** Every period of the timer (PDB in Teensy 3.x, QuadTimer in Teensy 4) starts a conversion of pin0 in ADC0
+        *   and of pin1 in ADC1 at the same time. Both modules should use the same resolution, averaging and speeds
+        *   so that they also finish at the same time.
+        *   Read the values with readSynchronizedSingle(), or stream them into one buffer of {adc0, adc1} pairs
+        *   with AnalogBufferDMA::initSynchronized() (call it before this function).
+        *   \param pin0 pin in ADC0
+        *   \param pin1 pin in ADC1
+        *   \param freq is the frequency of the pairs of conversions, it can't be lower that 1 Hz
+        *   \return true if the pins and the frequency are valid, false otherwise.
+        */
+        bool startSynchronizedTimer(uint8_t pin0, uint8_t pin1, uint32_t freq);
+
+        //! Stops the timer started by startSynchronizedTimer
+        void stopSynchronizedTimer();
+        #endif
+
         #endif
 
 
@@ -353,12 +480,108 @@ class ADC
         }
 
 
+        /* channel2sc1aADCx converts a pin number to their value for the SC1A register, for the ADC0 and ADC1
+        *  numbers with +ADC_SC1A_PIN_MUX (128) means those pins use mux a, the rest use mux b.
+        *  numbers with +ADC_SC1A_PIN_DIFF (64) means it's also a differential pin (treated also in the channel2sc1a_diff_ADCx)
+        *  They are constexpr so that the templated methods can use them at compile time.
+        */
+
+        ///////// ADC0
         //! Translate pin number to SC1A nomenclature
-        // should this be a constexpr?
-        static const uint8_t channel2sc1aADC0[ADC_MAX_PIN+1];
-        #ifdef ADC_DUAL_ADCS
+        #if defined(ADC_TEENSY_3_0)
+        static constexpr uint8_t channel2sc1aADC0[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 4, 0, 19, 3, 21, // 0-13, we treat them as A0-A13
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 4, // 14-23 (A0-A9)
+            31, 31, 31, 31, 31, 31, 31, 31, 31, 31, // 24-33
+            0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, 3+ADC_SC1A_PIN_DIFF, 21+ADC_SC1A_PIN_DIFF, // 34-37 (A10-A13)
+            26, 22, 23, 27, 29, 30 // 38-43: temp. sensor, VREF_OUT, A14, bandgap, VREFH, VREFL. A14 isn't connected to anything in Teensy 3.0.
+        };
+        #elif defined(ADC_TEENSY_3_1) // the only difference with 3.0 is that A13 is not connected to ADC0 and that T3.1 has PGA.
+        static constexpr uint8_t channel2sc1aADC0[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 4, 0, 19, 3, 31, // 0-13, we treat them as A0-A13
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 4, // 14-23 (A0-A9)
+            31, 31, 31, 31, 31, 31, 31, 31, 31, 31, // 24-33
+            0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, 3+ADC_SC1A_PIN_DIFF, 31+ADC_SC1A_PIN_DIFF, // 34-37 (A10-A13)
+            26, 22, 23, 27, 29, 30 // 38-43: temp. sensor, VREF_OUT, A14, bandgap, VREFH, VREFL. A14 isn't connected to anything in Teensy 3.0.
+        };
+        #elif defined(ADC_TEENSY_LC)
+        // Teensy LC
+        static constexpr uint8_t channel2sc1aADC0[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 11, 0, 4+ADC_SC1A_PIN_MUX, 23, 31, // 0-13, we treat them as A0-A12 + A13= doesn't exist
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 11, // 14-23 (A0-A9)
+            0+ADC_SC1A_PIN_DIFF, 4+ADC_SC1A_PIN_MUX+ADC_SC1A_PIN_DIFF, 23, 31, 31, 31, 31, 31, 31, 31, // 24-33 ((A10-A12) + nothing), A11 uses mux a
+            31, 31, 31, 31, // 34-37 nothing
+            26, 27, 31, 27, 29, 30 // 38-43: temp. sensor, , , bandgap, VREFH, VREFL.
+        };
+        #elif defined(ADC_TEENSY_3_5)
+        static constexpr uint8_t channel2sc1aADC0[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 4, 3, 31, 31, 31, // 0-13, we treat them as A0-A13
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 4, // 14-23 (A0-A9)
+            26, 27, 29, 30, 31, 31, 31, // 24-30: Temp_Sensor, bandgap, VREFH, VREFL.
+            31, 31, 17, 18,// 31-34 A12(ADC1), A13(ADC1), A14, A15
+            31, 31, 31, 31, 31, 31, 31, 31, 31, // 35-43
+            31, 31, 31, 31, 31, 31, 31, 31, 31, // 44-52
+            31, 31, 31, 31, 31, 31, 31, 31, 31, // 53-61
+            31, 31, 3+ADC_SC1A_PIN_DIFF, 31+ADC_SC1A_PIN_DIFF, 23, 31, 1, 31 // 62-69 64: A10, 65: A11 (NOT CONNECTED), 66: A21, 68: A25 (no diff)
+        };
+        #elif defined(ADC_TEENSY_3_6)
+        static constexpr uint8_t channel2sc1aADC0[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 4, 3, 31, 31, 31, // 0-13, we treat them as A0-A13
+            5, 14, 8, 9, 13, 12, 6, 7, 15, 4, // 14-23 (A0-A9)
+            26, 27, 29, 30, 31, 31, 31, // 24-30: Temp_Sensor, bandgap, VREFH, VREFL.
+            31, 31, 17, 18,// 31-34 A12(ADC1), A13(ADC1), A14, A15
+            31, 31, 31, 31, 31, 31, 31, 31, 31, // 35-43
+            31, 31, 31, 31, 31, 31, 31, 31, 31, // 44-52
+            31, 31, 31, 31, 31, 31, 31, 31, 31, // 53-61
+            31, 31, 3+ADC_SC1A_PIN_DIFF, 31+ADC_SC1A_PIN_DIFF, 23, 31 // 62-67 64: A10, 65: A11 (NOT CONNECTED), 66: A21, 67: A22(ADC1)
+        };
+        #elif defined(ADC_TEENSY_4)
+        static constexpr uint8_t channel2sc1aADC0[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            7, 8, 12, 11, 6, 5, 15, 0, 13, 14, 1, 2, 31, 31, // 0-13, we treat them as A0-A13
+            7, 8, 12, 11, 6, 5, 15, 0, 13, 14, // 14-23 (A0-A9)
+            1, 2, 31, 31 // A10, A11, A12, A13
+        };
+        #endif // defined
+
+        ///////// ADC1
         //! Translate pin number to SC1A nomenclature
-        static const uint8_t channel2sc1aADC1[ADC_MAX_PIN+1];
+        #if defined(ADC_TEENSY_3_1)
+        static constexpr uint8_t channel2sc1aADC1[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            31, 31, 8, 9, 31, 31, 31, 31, 31, 31, 3, 31, 0, 19, // 0-13, we treat them as A0-A13
+            31, 31, 8, 9, 31, 31, 31, 31, 31, 31, // 14-23 (A0-A9)
+            31, 31,  // 24,25 are digital only pins
+            5+ADC_SC1A_PIN_MUX, 5, 4, 6, 7, 4+ADC_SC1A_PIN_MUX, 31, 31, // 26-33 26=5a, 27=5b, 28=4b, 29=6b, 30=7b, 31=4a, 32,33 are digital only
+            3+ADC_SC1A_PIN_DIFF, 31+ADC_SC1A_PIN_DIFF, 0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, // 34-37 (A10-A13) A11 isn't connected.
+            26, 18, 31, 27, 29, 30 // 38-43: temp. sensor, VREF_OUT, A14 (not connected), bandgap, VREFH, VREFL.
+        };
+        #elif defined(ADC_TEENSY_3_5)
+        static constexpr uint8_t channel2sc1aADC1[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            31, 31, 8, 9, 31, 31, 31, 31, 31, 31, 31, 19, 14, 15, // 0-13, we treat them as A0-A13
+            31, 31, 8, 9, 31, 31, 31, 31, 31, 31, // 14-23 (A0-A9)
+            26, 27, 29, 30, 18, 31, 31,  // 24-30: Temp_Sensor, bandgap, VREFH, VREFL, VREF_OUT
+            14, 15, 31, 31, 4, 5, 6, 7, 17, // 31-39 A12-A20
+            31, 31, 31, 31, // 40-43
+            31, 31, 31, 31, 31, 10, 11, 31, 31, // 44-52, 49: A23, 50: A24
+            31, 31, 31, 31, 31, 31, 31, 31, 31, // 53-61
+            31, 31, 0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, 31, 23, 31, 1 // 62-69 64: A10, 65: A11, 67: A22, 69: A26 (not diff)
+        };
+        #elif defined(ADC_TEENSY_3_6)
+        static constexpr uint8_t channel2sc1aADC1[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            31, 31, 8, 9, 31, 31, 31, 31, 31, 31, 31, 19, 14, 15, // 0-13, we treat them as A0-A13
+            31, 31, 8, 9, 31, 31, 31, 31, 31, 31, // 14-23 (A0-A9)
+            26, 27, 29, 30, 18, 31, 31,  // 24-30: Temp_Sensor, bandgap, VREFH, VREFL, VREF_OUT
+            14, 15, 31, 31, 4, 5, 6, 7, 17, // 31-39 A12-A20
+            31, 31, 31, 23, // 40-43: A10(ADC0), A11(ADC0), A21, A22
+            31, 31, 31, 31, 31, 10, 11, 31, 31, // 44-52, 49: A23, 50: A24
+            31, 31, 31, 31, 31, 31, 31, 31, 31, // 53-61
+            31, 31, 0+ADC_SC1A_PIN_DIFF, 19+ADC_SC1A_PIN_DIFF, 31, 23 // 61-67 64: A10, 65: A11, 66: A21(ADC0), 67: A22
+        };
+        #elif defined(ADC_TEENSY_4)
+        static constexpr uint8_t channel2sc1aADC1[ADC_MAX_PIN+1] = { // new version, gives directly the sc1a number. 0x1F=31 deactivates the ADC.
+            7, 8, 12, 11, 6, 5, 15, 0, 13, 14, 31, 31, 3, 4, // 0-13, we treat them as A0-A13
+            7, 8, 12, 11, 6, 5, 15, 0, 13, 14, // 14-23 (A0-A9)
+            31, 31, 3, 4 // A10, A11, A12, A13
+        };
         #endif
 
         //! Translate pin number to SC1A nomenclature for differential pins
@@ -382,11 +605,4 @@ class ADC
 };
 
 
-
-
-#ifdef __cplusplus
-}
-#endif
-
-
 #endif // ADC_H
@@ -0,0 +1,231 @@
+/* Teensy 4, 3.x, LC ADC library
+ * https://github.com/pedvide/ADC
+ * Copyright (c) 2019 Pedro Villanueva
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* ADC_Decimator.h: Decimation filters for oversampled data, for example the blocks of AnalogBufferDMA.
+ */
+
+/*! \page decimator ADC decimator
+Decimation filters that turn many samples at a high rate into fewer samples with more bits at a lower rate.
+Instead of letting the ADC average up to 32 conversions per result, run it as fast as possible (with DMA)
+and filter the blocks with ADC_CIC and/or ADC_FIRDecimator.
+*/
+
+#ifndef ADC_DECIMATOR_H
+#define ADC_DECIMATOR_H
+
+#include <Arduino.h>
+
+#include <settings_defines.h>
+
+#ifdef ADC_USE_DMA
+#include "AnalogBufferDMA.h"
+#endif
+
+//! Cascaded integrator-comb (CIC) decimator
+/** It's a moving average of decimation samples applied order times, and keeps one output every decimation inputs.
+*   It only needs additions, the integrators wrap around but the outputs are exact as long as they fit in 32 bits:
+*   input_bits plus extraBits() must be 32 or less, otherwise it doesn't compile
+*   (for example 12 bits and order 2 allow a decimation up to 256, order 4 up to 32).
+*   The outputs have a gain of gain() = decimation^order, shift them right to keep only the bits you need.
+*   Each oversampling by 4 can add one bit of resolution, if there is enough noise in the input.
+*   \tparam order number of integrator and comb stages, from 1 to 6. Higher orders reject more aliasing.
+*   \tparam decimation number of inputs per output.
+*   \tparam input_bits bits of the inputs, the resolution of the ADC (16 by default).
+*/
+template<uint8_t order, uint16_t decimation, uint8_t input_bits = 16>
+class ADC_CIC {
+    static_assert((order >= 1) && (order <= 6), "ADC_CIC: order must be between 1 and 6");
+    static_assert(decimation >= 2, "ADC_CIC: decimation must be at least 2");
+    static_assert((input_bits >= 1) && (input_bits <= 16), "ADC_CIC: input_bits must be between 1 and 16");
+
+public:
+    ADC_CIC() {
+        // here extraBits() can be used, it isn't defined yet at the start of the class
+        static_assert(input_bits + extraBits() <= 32,
+                      "ADC_CIC: the outputs don't fit in 32 bits, use a lower order, decimation or input_bits");
+        reset();
+    }
+
+    //! Clear the state of the filter
+    void reset() {
+        for(uint8_t i=0; i<order; i++) {
+            integrator[i] = 0;
+            comb[i] = 0;
+        }
+        phase = 0;
+    }
+
+    //! Gain of the filter: decimation^order
+    static constexpr uint64_t gain() {
+        uint64_t g = 1;
+        for(uint8_t i=0; i<order; i++) {
+            g *= decimation;
+        }
+        return g;
+    }
+
+    //! Bits added to the input, order*log2(decimation) rounded up
+    static constexpr uint8_t extraBits() {
+        uint8_t bits = 0;
+        while((uint64_t(1) << bits) < gain()) {
+            bits++;
+        }
+        return bits;
+    }
+
+    //! Filter the samples and store the outputs
+    /** The state is kept between calls, so consecutive blocks can be of any size.
+    *   \param input samples to filter.
+    *   \param count number of values in input.
+    *   \param output array for the results, it needs room for count/(stride*decimation) + 1 values.
+    *   \param stride distance between consecutive samples, use 2 (and input+1 for the second channel)
+    *          for the pairs of AnalogBufferDMA::initSynchronized.
+    *   \return the number of outputs.
+    */
+    template<typename T>
+    uint32_t process(const volatile T *input, uint32_t count, uint32_t *output, uint8_t stride = 1) {
+        uint32_t num_outputs = 0;
+        for(uint32_t i=0; i<count; i+=stride) {
+            uint32_t value = input[i];
+            for(uint8_t k=0; k<order; k++) {
+                integrator[k] += value;
+                value = integrator[k];
+            }
+            if(++phase == decimation) {
+                phase = 0;
+                for(uint8_t k=0; k<order; k++) {
+                    const uint32_t previous = comb[k];
+                    comb[k] = value;
+                    value -= previous;
+                }
+                output[num_outputs++] = value;
+            }
+        }
+        return num_outputs;
+    }
+
+    #ifdef ADC_USE_DMA
+    //! Filter one block of an AnalogBufferDMA
+    /** \param block block returned by AnalogBufferDMA::readBlock().
+    *   \param output array for the results, it needs room for block.count/(num_channels*decimation) + 1 values.
+    *   \param channel which of the interleaved channels to filter (0 for ADC0, 1 for ADC1 with initSynchronized).
+    *   \param num_channels number of interleaved channels in the block.
+    *   \return the number of outputs.
+    */
+    uint32_t process(const AnalogBufferDMA::Block &block, uint32_t *output, uint8_t channel = 0, uint8_t num_channels = 1) {
+        return process(block.buffer + channel, block.count - channel, output, num_channels);
+    }
+    #endif
+
+private:
+    uint32_t integrator[order];
+    uint32_t comb[order];
+    uint16_t phase;
+};
+
+
+//! Decimating FIR filter
+/** Computes one output every decimation inputs, so it costs num_taps/decimation multiplications per input,
+*   like a polyphase filter. Use it alone or after an ADC_CIC to correct its droop and cut the aliasing further.
+*   The coefficients are Q15 (32768 is 1.0) by default, the sum of coefficient*sample is shifted right by shift bits.
+*   \tparam num_taps number of coefficients.
+*   \tparam decimation number of inputs per output (1 to filter without decimating).
+*/
+template<uint16_t num_taps, uint16_t decimation>
+class ADC_FIRDecimator {
+    static_assert(num_taps >= 1, "ADC_FIRDecimator: num_taps must be at least 1");
+    static_assert(decimation >= 1, "ADC_FIRDecimator: decimation must be at least 1");
+
+public:
+    //! Constructor
+    /** \param coefficients array of num_taps coefficients, coefficients[0] multiplies the oldest sample.
+    *          It's not copied, it must stay valid as long as the filter is used.
+    *   \param shift bits to shift the sum right, 15 for Q15 coefficients.
+    */
+    ADC_FIRDecimator(const int16_t *coefficients, uint8_t shift = 15) : coeffs(coefficients), shift_bits(shift) {
+        reset();
+    }
+
+    //! Clear the state of the filter
+    void reset() {
+        for(uint16_t i=0; i<2*num_taps; i++) {
+            history[i] = 0;
+        }
+        position = 0;
+        phase = 0;
+    }
+
+    //! Filter the samples and store the outputs
+    /** The state is kept between calls, so consecutive blocks can be of any size.
+    *   \param input samples to filter, they can be the outputs of an ADC_CIC.
+    *   \param count number of values in input.
+    *   \param output array for the results, it needs room for count/(stride*decimation) + 1 values.
+    *   \param stride distance between consecutive samples.
+    *   \return the number of outputs.
+    */
+    template<typename T>
+    uint32_t process(const volatile T *input, uint32_t count, int32_t *output, uint8_t stride = 1) {
+        uint32_t num_outputs = 0;
+        for(uint32_t i=0; i<count; i+=stride) {
+            // every sample is stored twice, so the last num_taps samples are always contiguous
+            history[position] = history[position + num_taps] = (int32_t)input[i];
+            if(++position == num_taps) {
+                position = 0;
+            }
+            if(++phase == decimation) {
+                phase = 0;
+                const int32_t *window = &history[position]; // oldest sample first
+                int64_t sum = 0;
+                for(uint16_t k=0; k<num_taps; k++) {
+                    sum += (int64_t)coeffs[k]*window[k];
+                }
+                output[num_outputs++] = (int32_t)(sum >> shift_bits);
+            }
+        }
+        return num_outputs;
+    }
+
+    #ifdef ADC_USE_DMA
+    //! Filter one block of an AnalogBufferDMA
+    /** \param block block returned by AnalogBufferDMA::readBlock().
+    *   \param output array for the results, it needs room for block.count/(num_channels*decimation) + 1 values.
+    *   \param channel which of the interleaved channels to filter (0 for ADC0, 1 for ADC1 with initSynchronized).
+    *   \param num_channels number of interleaved channels in the block.
+    *   \return the number of outputs.
+    */
+    uint32_t process(const AnalogBufferDMA::Block &block, int32_t *output, uint8_t channel = 0, uint8_t num_channels = 1) {
+        return process(block.buffer + channel, block.count - channel, output, num_channels);
+    }
+    #endif
+
+private:
+    const int16_t *coeffs;
+    uint8_t shift_bits;
+    int32_t history[2*num_taps];
+    uint16_t position;
+    uint16_t phase;
+};
+
+#endif // ADC_DECIMATOR_H
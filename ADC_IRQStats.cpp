@@ -0,0 +1,106 @@
+/* Teensy 4, 3.x, LC ADC library
+ * https://github.com/pedvide/ADC
+ * Copyright (c) 2019 Pedro Villanueva
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* ADC_IRQStats.cpp: Optional measurement of the time the library keeps the interrupts disabled.
+ */
+
+#include "ADC_IRQStats.h"
+
+#ifdef ADC_IRQ_STATS
+
+namespace ADC_IRQStats {
+
+    Site *masking_site = nullptr;
+    uint32_t masked_since = 0;
+
+    // sites that have recorded something, newest first
+    static Site *sites = nullptr;
+
+
+    /* Adds the time to the statistics of the site.
+    *  It's called with the interrupts disabled.
+    */
+    void record(Site *site, uint32_t time) {
+        if (!site->registered) {
+            site->registered = true;
+            site->next = sites;
+            sites = site;
+        }
+        site->count++;
+        if (time > site->max_cycles) {
+            site->max_cycles = time;
+        }
+        uint8_t bin = time ? 31 - __builtin_clz(time) : 0;
+        if (bin >= ADC_IRQ_STATS_BINS) {
+            bin = ADC_IRQ_STATS_BINS - 1;
+        }
+        site->histogram[bin]++;
+    }
+
+    Site* firstSite() {
+        return sites;
+    }
+
+    uint32_t maxCycles() {
+        uint32_t max_cycles = 0;
+        for (Site *site = sites; site; site = site->next) {
+            if (site->max_cycles > max_cycles) {
+                max_cycles = site->max_cycles;
+            }
+        }
+        return max_cycles;
+    }
+
+    void reset() {
+        const bool irq_enabled = ADC_Cpu::disableIRQ();
+        for (Site *site = sites; site; site = site->next) {
+            site->count = 0;
+            site->max_cycles = 0;
+            for (uint8_t i = 0; i < ADC_IRQ_STATS_BINS; i++) {
+                site->histogram[i] = 0;
+            }
+        }
+        ADC_Cpu::restoreIRQ(irq_enabled);
+    }
+
+    void print(Print &out) {
+        for (Site *site = sites; site; site = site->next) {
+            // copy it so the numbers are consistent
+            const bool irq_enabled = ADC_Cpu::disableIRQ();
+            const Site copy = *site;
+            ADC_Cpu::restoreIRQ(irq_enabled);
+
+            out.printf("%s:%u count %lu max %lu cycles, histogram", copy.function, copy.line,
+                       (unsigned long)copy.count, (unsigned long)copy.max_cycles);
+            for (uint8_t i = 0; i < ADC_IRQ_STATS_BINS; i++) {
+                out.printf(" %lu", (unsigned long)copy.histogram[i]);
+            }
+            out.println();
+        }
+    }
+
+}
+
+#endif // ADC_IRQ_STATS
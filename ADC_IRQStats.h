@@ -0,0 +1,131 @@
+/* Teensy 4, 3.x, LC ADC library
+ * https://github.com/pedvide/ADC
+ * Copyright (c) 2019 Pedro Villanueva
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* ADC_IRQStats.h: Optional measurement of the time the library keeps the interrupts disabled.
+ */
+
+/*! \page irq_stats ADC interrupt masking statistics
+Every place where the library disables the interrupts uses ADC_DISABLE_IRQ() and ADC_ENABLE_IRQ().
+Normally they are just __disable_irq() and __enable_irq(). If ADC_IRQ_STATS is defined (uncomment it below),
+each call site records how many times it masked the interrupts, the longest time and a histogram of the times,
+in CPU cycles. Use ADC_IRQStats::print() or go through the sites with ADC_IRQStats::firstSite().
+See the namespace ADC_IRQStats for all functions.
+*/
+
+#ifndef ADC_IRQSTATS_H
+#define ADC_IRQSTATS_H
+
+#include <settings_defines.h>
+
+// Uncomment to measure the time the interrupts are disabled by the library
+//#define ADC_IRQ_STATS
+
+#ifdef ADC_IRQ_STATS
+
+// Number of bins of the histograms, bin i counts the times between 2^i and 2^(i+1)-1 cycles,
+// the last one also counts all longer times.
+#ifndef ADC_IRQ_STATS_BINS
+#define ADC_IRQ_STATS_BINS (16)
+#endif
+
+//! Statistics of the time the library keeps the interrupts disabled.
+namespace ADC_IRQStats {
+
+    //! Statistics of one place of the library that disables the interrupts
+    struct Site {
+        const char *function; //!< function that disables the interrupts
+        uint16_t line; //!< line of the source file
+        uint32_t count; //!< number of times
+        uint32_t max_cycles; //!< longest time, in CPU cycles
+        uint32_t histogram[ADC_IRQ_STATS_BINS]; //!< see ADC_IRQ_STATS_BINS
+        Site *next; //!< next site that has recorded something, or nullptr
+        bool registered; //!< is it in the list of sites?
+    };
+
+    //! \cond internal
+    // site that disabled the interrupts, nullptr if they are enabled
+    extern Site *masking_site;
+    // cycle counter when the interrupts were disabled
+    extern uint32_t masked_since;
+
+    // adds the time to the statistics of the site
+    void record(Site *site, uint32_t time);
+
+    // call after disabling the interrupts, nested calls are ignored
+    __attribute__((always_inline)) inline void masked(Site *site) {
+        if (!masking_site) {
+            masking_site = site;
+            masked_since = ADC_Cpu::cycles();
+        }
+    }
+
+    // call before enabling the interrupts
+    __attribute__((always_inline)) inline void unmasking() {
+        if (masking_site) {
+            record(masking_site, ADC_Cpu::cycles() - masked_since);
+            masking_site = nullptr;
+        }
+    }
+    //! \endcond
+
+    //! First site that has disabled the interrupts, follow Site::next for the rest
+    Site* firstSite();
+
+    //! Longest time of all sites, in CPU cycles
+    uint32_t maxCycles();
+
+    //! Clears the statistics of all sites
+    void reset();
+
+    //! Prints the statistics of all sites
+    /** One line per site: function, line, count, maximum cycles and the histogram (from 1 cycle up).
+    *   \param out where to print, for example Serial.
+    */
+    void print(Print &out);
+
+}
+
+//! Disable the interrupts and start measuring
+#define ADC_DISABLE_IRQ() do { \
+        __disable_irq(); \
+        static ADC_IRQStats::Site adc_irq_site = {__func__, __LINE__, 0, 0, {}, nullptr, false}; \
+        ADC_IRQStats::masked(&adc_irq_site); \
+    } while(0)
+//! Stop measuring and enable the interrupts
+#define ADC_ENABLE_IRQ() do { \
+        ADC_IRQStats::unmasking(); \
+        __enable_irq(); \
+    } while(0)
+
+#else
+
+//! Disable the interrupts
+#define ADC_DISABLE_IRQ() __disable_irq()
+//! Enable the interrupts
+#define ADC_ENABLE_IRQ() __enable_irq()
+
+#endif // ADC_IRQ_STATS
+
+#endif // ADC_IRQSTATS_H
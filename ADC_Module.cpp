@@ -36,18 +36,25 @@
 #include <VREF.h>
 #endif
 
+// the calibration can be saved in the EEPROM
+#if ADC_CALIB_CACHE_SIZE > 0
+#include <avr/eeprom.h>
+#endif
+
+volatile uint16_t ADC_Module::conversion_id[ADC_NUM_ADCS] = {};
 
 /* Constructor
 *   Point the registers to the correct ADC module
 *   Copy the correct channel2sc1a
-*   Call init
+*   Call init, unless it's deferred to begin()
 */
 ADC_Module::ADC_Module(uint8_t ADC_number, 
                        const uint8_t* const a_channel2sc1a, 
                        #if ADC_DIFF_PAIRS > 0
                        const ADC_NLIST* const a_diff_table,
                        #endif
-                       ADC_REGS_t &a_adc_regs) :
+                       ADC_REGS_t &a_adc_regs,
+                       bool init) :
         ADC_num(ADC_number)
         , channel2sc1a(a_channel2sc1a)
         #if ADC_DIFF_PAIRS > 0
@@ -56,12 +63,15 @@ ADC_Module::ADC_Module(uint8_t ADC_number,
         , adc_regs(a_adc_regs)
         #ifdef ADC_USE_PDB
         , PDB0_CHnC1(ADC_num? PDB0_CH1C1 : PDB0_CH0C1)
+        , PDB0_CHnDLY0(ADC_num? PDB0_CH1DLY0 : PDB0_CH0DLY0)
+        , PDB0_CHnDLY1(ADC_num? PDB0_CH1DLY1 : PDB0_CH0DLY1)
         #endif
         #if defined(ADC_TEENSY_4)
         , XBAR_IN(ADC_num? XBARA1_IN_QTIMER4_TIMER3 : XBARA1_IN_QTIMER4_TIMER0)
         , XBAR_OUT(ADC_num? XBARA1_OUT_ADC_ETC_TRIG10 : XBARA1_OUT_ADC_ETC_TRIG00)
         , QTIMER4_INDEX(ADC_num? 3 : 0)
         , ADC_ETC_TRIGGER_INDEX(ADC_num? 4 : 0) 
+        , etc_chain_length(0)
         , IRQ_ADC(ADC_num? IRQ_NUMBER_t::IRQ_ADC2 : IRQ_NUMBER_t::IRQ_ADC1)        
         #elif defined(ADC_DUAL_ADCS)
         // IRQ_ADC0 and IRQ_ADC1 aren't consecutive in Teensy 3.6
@@ -72,9 +82,17 @@ ADC_Module::ADC_Module(uint8_t ADC_number,
         #endif
         {
 
+    #if defined(ADC_IRQ_STATS) || defined(ADC_TRACE)
+    ADC_Cpu::beginCycles(); // to measure the interrupt masking and for the timestamps of the trace
+    #endif
 
-    // call our init
-    analog_init();
+    // call our init, or wait for begin()
+    if (init) {
+        analog_init();
+    } else {
+        calibrating = 0;
+        init_calib = 2; // not ready
+    }
 
 }
 
@@ -83,10 +101,11 @@ ADC_Module::ADC_Module(uint8_t ADC_number,
 *  - Clear all fail flags
 *  - Internal reference (default: external vcc)
 *  - Mux between a and b channels (b channels)
-*  - Calibrate with 32 averages and low speed
+*  - Resolution (default: 10 bits)
+*  - Start the calibration with 32 averages and low speed, it doesn't wait for it
 *  - When first calibration is done it sets:
-*     - Resolution (default: 10 bits)
-*     - Conversion speed and sampling time (both set to medium speed)
+*     - Conversion speed and sampling time (both set to medium speed) and calibrates again
+*  - When the second calibration is done it sets:
 *     - Averaging (set to 4)
 */
 void ADC_Module::analog_init() {
@@ -124,6 +143,25 @@ void ADC_Module::analog_init() {
 
     calibrating = 0;
 
+    queue_head = 0;
+    queue_count = 0;
+
+    stream_priority = ADC_PRIORITY::BACKGROUND;
+
+    async_interrupt = false;
+    async_id = 0;
+    async_done = false;
+    async_value = ADC_ERROR_VALUE;
+    #if defined(__cpp_impl_coroutine)
+    async_coroutine = nullptr;
+    #endif
+
+    clearCalibrationCache();
+    #if ADC_CALIB_CACHE_SIZE > 0
+    calib_check_pending = false;
+    calib_drifted = false;
+    #endif
+
     fail_flag = ADC_ERROR::CLEAR; // clear all errors
 
     num_measurements = 0;
@@ -136,27 +174,51 @@ void ADC_Module::analog_init() {
     atomic::setBitFlag(adc_regs.CFG2, ADC_CFG2_MUXSEL);
     #endif
 
-    // set reference to vcc
-    setReference(ADC_REFERENCE::REF_3V3);
+    // the first calibration will use 32 averages and lowest speed,
+    // when this calibration is over the averages and speed will be set to default by calibrationDone and init_calib will be cleared.
+    init_calib = 2;
 
     // set resolution to 10
     setResolution(10);
 
-    // the first calibration will use 32 averages and lowest speed,
-    // when this calibration is over the averages and speed will be set to default by wait_for_cal and init_calib will be cleared.
-    init_calib = 1;
+    // nothing is calibrating yet, so these don't wait
     setAveraging(32);
-    setConversionSpeed(ADC_CONVERSION_SPEED::LOW_SPEED);
     setSamplingSpeed(ADC_SAMPLING_SPEED::LOW_SPEED);
 
-    // begin init calibration
+    // set reference to vcc and the lowest speed without calibrating for each one
+    writeReference(static_cast<ADC_REF_SOURCE>(ADC_REFERENCE::REF_3V3));
+    writeConversionSpeed(ADC_CONVERSION_SPEED::LOW_SPEED);
+
+    // begin init calibration, it doesn't wait for it to finish
     calibrate();
 }
 
 // starts calibration
 void ADC_Module::calibrate() {
 
-    __disable_irq();
+    ADC_DISABLE_IRQ();
+
+    #if ADC_CALIB_CACHE_SIZE > 0
+    // this profile was calibrated before: restore the results, no need to wait for a new calibration
+    CalibrationEntry *entry = init_calib ? nullptr : findCalibration();
+    if (entry) {
+        #ifdef ADC_TEENSY_4
+        atomic::clearBitFlag(adc_regs.GC, ADC_GC_CAL); // stop possible previous calibration
+        atomic::setBitFlag(adc_regs.GS, ADC_GS_CALF); // clear possible previous error
+        adc_regs.CAL = entry->cal;
+        #else
+        atomic::clearBitFlag(adc_regs.SC3, ADC_SC3_CAL);
+        atomic::setBitFlag(adc_regs.SC3, ADC_SC3_CALF);
+        adc_regs.OFS = entry->ofs;
+        adc_regs.PG = entry->pg;
+        adc_regs.MG = entry->mg;
+        #endif
+        calibrating = 0;
+        ADC_TRACE_EVENT(CALIBRATION_END, ADC_num, 2); // restored from the cache
+        ADC_ENABLE_IRQ();
+        return;
+    }
+    #endif
 
     calibrating = 1;
     #ifdef ADC_TEENSY_4
@@ -171,38 +233,71 @@ void ADC_Module::calibrate() {
     // ADC_SC3_cal = 1; // start calibration
     atomic::setBitFlag(adc_regs.SC3, ADC_SC3_CAL);
     #endif
+    ADC_TRACE_EVENT(CALIBRATION_START, ADC_num, 0);
 
-    __enable_irq();
+    ADC_ENABLE_IRQ();
 }
 
 
 /* Waits until calibration is finished and writes the corresponding registers
-*
+*  At startup there are two calibrations, it waits for both.
 */
 void ADC_Module::wait_for_cal(void) {
-    
-    // wait for calibration to finish
-    #ifdef ADC_TEENSY_4
-    while(atomic::getBitFlag(adc_regs.GC, ADC_GC_CAL)) { // Bit ADC_GC_CAL in register GC cleared when calib. finishes.
-        yield();
+
+    if (!calibrating) {
+        return;
     }
-    if(atomic::getBitFlag(adc_regs.GS, ADC_GS_CALF)) { // calibration failed
-        fail_flag |= ADC_ERROR::CALIB; // the user should know and recalibrate manually
-    }        
-    #else
-    while(atomic::getBitFlag(adc_regs.SC3, ADC_SC3_CAL)) { // Bit ADC_SC3_CAL in register ADC0_SC3 cleared when calib. finishes.
-        yield();
+
+    do {
+        // wait for calibration to finish
+        while(calibrationRunning()) {
+            yield();
+        }
+        calibrationDone();
+    } while(calibrating);
+
+}
+
+/* Returns true if the module is initialized and calibrated, it never waits
+*  If a calibration just finished it writes the registers, like wait_for_cal.
+*/
+bool ADC_Module::isReady() {
+    if (calibrating && !calibrationRunning()) {
+        calibrationDone(); // it can start the second calibration at startup
     }
-    if(atomic::getBitFlag(adc_regs.SC3, ADC_SC3_CALF)) { // calibration failed
+    return !calibrating && !init_calib;
+}
+
+// Is the hardware calibrating?
+bool ADC_Module::calibrationRunning() {
+    #ifdef ADC_TEENSY_4
+    return atomic::getBitFlag(adc_regs.GC, ADC_GC_CAL); // Bit ADC_GC_CAL in register GC cleared when calib. finishes.
+    #else
+    return atomic::getBitFlag(adc_regs.SC3, ADC_SC3_CAL); // Bit ADC_SC3_CAL in register ADC0_SC3 cleared when calib. finishes.
+    #endif
+}
+
+/* The calibration finished: write the corresponding registers
+*  After the first calibration at startup set the speeds to default and calibrate again,
+*  after the second one set the averages to default.
+*/
+void ADC_Module::calibrationDone() {
+
+    #ifdef ADC_TEENSY_4
+    const bool cal_failed = atomic::getBitFlag(adc_regs.GS, ADC_GS_CALF);
+    #else
+    const bool cal_failed = atomic::getBitFlag(adc_regs.SC3, ADC_SC3_CALF);
+    #endif
+    if(cal_failed) { // calibration failed
         fail_flag |= ADC_ERROR::CALIB; // the user should know and recalibrate manually
     }
-    #endif
+    ADC_TRACE_EVENT(CALIBRATION_END, ADC_num, cal_failed);
 
     // set calibrated values to registers
     #ifdef ADC_TEENSY_4
     // T4 does not require anything else for calibration
     #else
-    __disable_irq();
+    ADC_DISABLE_IRQ();
     uint16_t sum;
     if (calibrating) {
         sum = adc_regs.CLPS + adc_regs.CLP4 + adc_regs.CLP3 + adc_regs.CLP2 + adc_regs.CLP1 + adc_regs.CLP0;
@@ -215,25 +310,37 @@ void ADC_Module::wait_for_cal(void) {
 
         
     }
-    __enable_irq();
+    ADC_ENABLE_IRQ();
+    #endif
+    #if ADC_CALIB_CACHE_SIZE > 0
+    if (calibrating && !cal_failed) {
+        storeCalibration();
+    }
+    if (calibrating && calib_check_pending) {
+        finishCalibrationCheck();
+    }
     #endif
     calibrating = 0;
     
 
     // the first calibration uses 32 averages and lowest speed,
-    // when this calibration is over, set the averages and speed to default.
-    if(init_calib) {
+    // when this calibration is over, set the speeds to default and calibrate again (still with 32 averages).
+    if(init_calib == 2) {
 
-        // set conversion speed to medium
-        setConversionSpeed(ADC_CONVERSION_SPEED::MED_SPEED);
+        init_calib = 1;
 
-        // set sampling speed to medium
+        // set sampling speed to medium (before calibrating, it would wait)
         setSamplingSpeed(ADC_SAMPLING_SPEED::MED_SPEED);
 
-        // number of averages to 4
-        setAveraging(4);
+        // set conversion speed to medium, it starts the second calibration
+        setConversionSpeed(ADC_CONVERSION_SPEED::MED_SPEED);
+
+    } else if(init_calib == 1) {
 
         init_calib = 0; // clear
+
+        // number of averages to 4
+        setAveraging(4);
     }
 
 }
@@ -244,6 +351,8 @@ void ADC_Module::wait_for_cal(void) {
 */
 void ADC_Module::recalibrate() {
 
+    clearCalibrationCache(); // the old results may not be valid anymore
+
     calibrate();
 
     wait_for_cal();
@@ -251,6 +360,240 @@ void ADC_Module::recalibrate() {
 
 
 
+// Forget all the calibration results stored in the cache
+void ADC_Module::clearCalibrationCache() {
+    #if ADC_CALIB_CACHE_SIZE > 0
+    for(uint8_t i=0; i<ADC_CALIB_CACHE_SIZE; i++) {
+        calib_cache[i].valid = false;
+    }
+    calib_cache_next = 0;
+    #endif
+}
+
+#if ADC_CALIB_CACHE_SIZE > 0
+// Find the cached calibration of the current conversion speed and reference
+// Only setConversionSpeed and setReference calibrate, the resolution and averaging don't change the results
+ADC_Module::CalibrationEntry* ADC_Module::findCalibration() {
+    for(uint8_t i=0; i<ADC_CALIB_CACHE_SIZE; i++) {
+        CalibrationEntry &entry = calib_cache[i];
+        if (entry.valid && (entry.speed == conversion_speed) && (entry.reference == analog_reference_internal)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Store the results of the calibration of the current conversion speed and reference, replacing the oldest entry if the cache is full
+void ADC_Module::storeCalibration() {
+    CalibrationEntry *entry = findCalibration();
+    for(uint8_t i=0; !entry && (i<ADC_CALIB_CACHE_SIZE); i++) { // use a free entry
+        if (!calib_cache[i].valid) {
+            entry = &calib_cache[i];
+        }
+    }
+    if (!entry) {
+        entry = &calib_cache[calib_cache_next];
+        calib_cache_next = (calib_cache_next + 1) % ADC_CALIB_CACHE_SIZE;
+    }
+
+    entry->speed = conversion_speed;
+    entry->reference = analog_reference_internal;
+    #ifdef ADC_TEENSY_4
+    entry->cal = adc_regs.CAL;
+    #else
+    entry->ofs = adc_regs.OFS;
+    entry->pg = adc_regs.PG;
+    entry->mg = adc_regs.MG;
+    #endif
+    entry->valid = true;
+}
+
+// Board, clocks and module that made the calibration, the saved calibration isn't valid if any of them changes
+uint32_t ADC_Module::calibrationFingerprint() {
+    #if defined(ADC_TEENSY_3_0)
+    const uint32_t board = 30;
+    #elif defined(ADC_TEENSY_3_1)
+    const uint32_t board = 31;
+    #elif defined(ADC_TEENSY_3_5)
+    const uint32_t board = 35;
+    #elif defined(ADC_TEENSY_3_6)
+    const uint32_t board = 36;
+    #elif defined(ADC_TEENSY_LC)
+    const uint32_t board = 26;
+    #else
+    const uint32_t board = 40;
+    #endif
+    const uint32_t values[] = {board, ADC_num, (uint32_t)(F_CPU), (uint32_t)(ADC_F_BUS),
+                               ADC_CALIB_CACHE_SIZE, sizeof(CalibrationEntry)};
+
+    // FNV-1a hash
+    uint32_t hash = 2166136261UL;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(values);
+    for(size_t i=0; i<sizeof(values); i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+// Checksum of all the bytes of the record before the checksum itself
+uint32_t ADC_Module::calibrationChecksum(const CalibrationRecord &record) {
+    uint32_t checksum = 0;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&record);
+    for(size_t i=0; i<offsetof(CalibrationRecord, checksum); i++) {
+        checksum = ((checksum << 1) | (checksum >> 31)) + bytes[i];
+    }
+    return checksum;
+}
+
+// Compare the new calibration of the current profile with the old one
+void ADC_Module::finishCalibrationCheck() {
+    calib_check_pending = false;
+
+    if ((calib_check_ref.speed != conversion_speed) || (calib_check_ref.reference != analog_reference_internal)) {
+        return; // the profile changed before the calibration finished, nothing to compare
+    }
+
+    CalibrationEntry *entry = findCalibration();
+    if (!entry) { // the calibration failed
+        calib_drifted = true;
+        return;
+    }
+
+    #ifdef ADC_TEENSY_4
+    const int32_t differences[] = {(int32_t)entry->cal - (int32_t)calib_check_ref.cal};
+    #else
+    // OFS is signed, PG and MG are not
+    const int32_t differences[] = {(int16_t)entry->ofs - (int16_t)calib_check_ref.ofs,
+                                   (int32_t)entry->pg - (int32_t)calib_check_ref.pg,
+                                   (int32_t)entry->mg - (int32_t)calib_check_ref.mg};
+    #endif
+
+    calib_drifted = false;
+    for(int32_t difference : differences) {
+        if ((difference > calib_check_max_difference) || (-difference > calib_check_max_difference)) {
+            calib_drifted = true;
+        }
+    }
+
+    if (calib_drifted) { // the other profiles are probably wrong too, keep only the new one
+        const CalibrationEntry new_entry = *entry;
+        clearCalibrationCache();
+        calib_cache[0] = new_entry;
+        calib_cache_next = 1 % ADC_CALIB_CACHE_SIZE;
+    }
+}
+#endif
+
+// Save the calibration cache to the EEPROM
+bool ADC_Module::saveCalibration(int address) {
+    #if ADC_CALIB_CACHE_SIZE > 0
+    if (calibrating) wait_for_cal();
+
+    CalibrationRecord record;
+    record.magic = CALIBRATION_MAGIC;
+    record.fingerprint = calibrationFingerprint();
+    bool any_valid = false;
+    for(uint8_t i=0; i<ADC_CALIB_CACHE_SIZE; i++) {
+        record.entries[i] = calib_cache[i];
+        any_valid |= calib_cache[i].valid;
+    }
+    if (!any_valid) {
+        return false;
+    }
+
+    record.checksum = calibrationChecksum(record);
+
+    eeprom_write_block(&record, reinterpret_cast<void*>(address), sizeof(record));
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+// Load the calibration cache from the EEPROM
+bool ADC_Module::loadCalibration(int address) {
+    #if ADC_CALIB_CACHE_SIZE > 0
+    CalibrationRecord record;
+    eeprom_read_block(&record, reinterpret_cast<const void*>(address), sizeof(record));
+
+    if ((record.magic != CALIBRATION_MAGIC) || (record.fingerprint != calibrationFingerprint())
+        || (record.checksum != calibrationChecksum(record))) {
+        return false; // saved by another board or with other clocks, or never saved
+    }
+
+    ADC_DISABLE_IRQ();
+    // stop the calibration that is taking place, the loaded one will be used instead
+    #ifdef ADC_TEENSY_4
+    atomic::clearBitFlag(adc_regs.GC, ADC_GC_CAL);
+    #else
+    atomic::clearBitFlag(adc_regs.SC3, ADC_SC3_CAL);
+    #endif
+    calibrating = 0;
+    const bool init_pending = init_calib;
+    init_calib = 0;
+    calib_check_pending = false;
+    ADC_ENABLE_IRQ();
+
+    clearCalibrationCache();
+    for(uint8_t i=0; i<ADC_CALIB_CACHE_SIZE; i++) {
+        calib_cache[i] = record.entries[i];
+    }
+
+    // the startup calibrations were cut short, set the defaults that calibrationDone would have set
+    if (init_pending) {
+        setSamplingSpeed(ADC_SAMPLING_SPEED::MED_SPEED);
+        setAveraging(4);
+    }
+
+    // restore the current profile, or calibrate it if it wasn't saved
+    if (init_pending && (conversion_speed != ADC_CONVERSION_SPEED::MED_SPEED)) {
+        setConversionSpeed(ADC_CONVERSION_SPEED::MED_SPEED); // it calls calibrate
+    } else {
+        calibrate();
+    }
+
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+// Start a new calibration of the current profile and compare it with the cached one
+bool ADC_Module::startCalibrationCheck(uint16_t max_difference) {
+    #if ADC_CALIB_CACHE_SIZE > 0
+    if (calibrating) wait_for_cal();
+
+    CalibrationEntry *entry = findCalibration();
+    if (!entry) {
+        return false;
+    }
+
+    calib_check_ref = *entry;
+    calib_check_max_difference = max_difference;
+    calib_check_pending = true;
+    calib_drifted = false;
+
+    entry->valid = false; // calibrate again instead of using the cache
+    calibrate();
+
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+// Result of the last startCalibrationCheck
+bool ADC_Module::calibrationDrifted() {
+    #if ADC_CALIB_CACHE_SIZE > 0
+    if (calibrating) wait_for_cal();
+
+    return calib_drifted;
+    #else
+    return false;
+    #endif
+}
+
+
 /////////////// METHODS TO SET/GET SETTINGS OF THE ADC ////////////////////
 
 
@@ -259,10 +602,19 @@ void ADC_Module::recalibrate() {
 *  Use ADC_REF_3V3, ADC_REF_1V2 (not for Teensy LC) or ADC_REF_EXT
 */
 void ADC_Module::setReference(ADC_REFERENCE type) {
-    ADC_REF_SOURCE ref_type = static_cast<ADC_REF_SOURCE>(type); // cast to source type, that is, either internal or default
+    // cast to source type, that is, either internal or default
+    if (writeReference(static_cast<ADC_REF_SOURCE>(type))) {
+        calibrate();
+    }
+}
+
+/* Select the reference, it returns false if it didn't change
+*  It doesn't calibrate
+*/
+bool ADC_Module::writeReference(ADC_REF_SOURCE ref_type) {
 
     if (analog_reference_internal==ref_type) { // don't need to change anything
-        return;
+        return false;
     }
 
     if (ref_type == ADC_REF_SOURCE::REF_ALT) { // 1.2V ref for Teensy 3.x, 3.3 VDD for Teensy LC
@@ -297,7 +649,7 @@ void ADC_Module::setReference(ADC_REFERENCE type) {
         #endif
     }
 
-    calibrate();
+    return true;
 }
 
 
@@ -397,6 +749,81 @@ uint32_t ADC_Module::getMaxValue() {
 }
 
 
+/* Frequency of the ADC clock (ADCK) with the current settings
+*
+*/
+uint32_t ADC_Module::getADCClock() {
+    #ifdef ADC_TEENSY_4
+    const uint32_t cfg = adc_regs.CFG;
+    const uint32_t adiclk = cfg & ADC_CFG_ADICLK(3);
+    const uint32_t adiv = (cfg & ADC_CFG_ADIV(3)) >> 5;
+    if (adiclk == ADC_CFG_ADICLK(3)) { // ADACK
+        return (conversion_speed == ADC_CONVERSION_SPEED::ADACK_20) ? 20000000 : 10000000;
+    }
+    #else
+    const uint32_t cfg1 = adc_regs.CFG1;
+    const uint32_t adiclk = cfg1 & ADC_CFG1_ADICLK(3);
+    const uint32_t adiv = (cfg1 & ADC_CFG1_ADIV(3)) >> 5;
+    if (adiclk == ADC_CFG1_ADICLK(3)) { // ADACK
+        switch(conversion_speed) {
+            case ADC_CONVERSION_SPEED::ADACK_2_4: return 2400000;
+            case ADC_CONVERSION_SPEED::ADACK_4_0: return 4000000;
+            case ADC_CONVERSION_SPEED::ADACK_5_2: return 5200000;
+            default: return 6200000;
+        }
+    }
+    #endif
+    // bus or bus/2, divided by 1, 2, 4 or 8
+    return (ADC_F_BUS >> (adiclk == 1 ? 1 : 0)) >> adiv;
+}
+
+/* Estimated duration of one conversion in CPU cycles
+*  The ADCK cycles of the conversion (depends on the resolution), the sampling and the setup, times the averages.
+*/
+uint32_t ADC_Module::getConversionTime() {
+    #ifdef ADC_TEENSY_4
+    const uint8_t sampling_adck[] = {24, 20, 16, 12, 8, 6, 4, 2}; // in the order of ADC_SAMPLING_SPEED
+    const uint32_t conversion_adck = (analog_res_bits <= 8) ? 17 : ((analog_res_bits <= 10) ? 21 : 25);
+    const uint32_t f_cpu = F_CPU_ACTUAL;
+    #else
+    const uint8_t sampling_adck[] = {24, 16, 10, 6, 0};
+    const uint32_t conversion_adck = (analog_res_bits <= 8) ? 17 : ((analog_res_bits <= 12) ? 20 : 25);
+    const uint32_t f_cpu = F_CPU;
+    #endif
+    const uint32_t averages = (analog_num_average > 1) ? analog_num_average : 1;
+    const uint32_t adck = 5 + averages*(conversion_adck + sampling_adck[static_cast<uint8_t>(sampling_speed)]);
+
+    return (uint64_t)adck*f_cpu/getADCClock();
+}
+
+/* Estimated time in CPU cycles until a conversion started now would be ready
+*  Calibration (if any) + conversion in progress (if any) + the new conversion.
+*/
+uint32_t ADC_Module::getExpectedWait() {
+    if (isStreaming()) {
+        return ADC_WAIT_STREAMING;
+    }
+
+    const uint32_t conversion = getConversionTime();
+    uint32_t wait = conversion;
+    if (calibrating) {
+        // the calibration takes about 14k ADCK cycles
+        #ifdef ADC_TEENSY_4
+        wait += (uint64_t)14000*F_CPU_ACTUAL/getADCClock();
+        #else
+        wait += (uint64_t)14000*F_CPU/getADCClock();
+        #endif
+    }
+    if (isConverting() || (num_measurements > 0)) {
+        wait += conversion; // another conversion is taking place
+    }
+    if (queue_count > 1) {
+        wait += (queue_count - 1)*conversion; // the first one is the conversion taking place
+    }
+    return wait;
+}
+
+
 // Sets the conversion speed
 /* Increase the sampling speed for low impedance sources, decrease it for higher impedance ones.
 * \param speed can be any of the ADC_SAMPLING_SPEED enum: VERY_LOW_SPEED, LOW_SPEED, MED_SPEED, HIGH_SPEED or VERY_HIGH_SPEED.
@@ -408,9 +835,18 @@ uint32_t ADC_Module::getMaxValue() {
 * VERY_HIGH_SPEED is the highest possible sampling speed (0 ADCK added).
 */
 void ADC_Module::setConversionSpeed(ADC_CONVERSION_SPEED speed) {
+    if (writeConversionSpeed(speed)) {
+        calibrate();
+    }
+}
+
+/* Select the clock and divisor of the speed, it returns false if it didn't change
+*  It doesn't calibrate
+*/
+bool ADC_Module::writeConversionSpeed(ADC_CONVERSION_SPEED speed) {
 
     if(speed==conversion_speed) { // no change
-        return;
+        return false;
     }
 
     //if (calibrating) wait_for_cal();
@@ -430,8 +866,7 @@ void ADC_Module::setConversionSpeed(ADC_CONVERSION_SPEED speed) {
         #endif
         case ADC_CONVERSION_SPEED::LOW_SPEED:
             #ifdef ADC_TEENSY_4
-            atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADHSC);
-            atomic::setBitFlag(adc_regs.CFG, ADC_CFG_ADLPC);
+            atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADHSC | ADC_CFG_ADLPC, ADC_CFG_ADLPC);
             #else
             atomic::clearBitFlag(adc_regs.CFG2, ADC_CFG2_ADHSC);
             atomic::setBitFlag(adc_regs.CFG1, ADC_CFG1_ADLPC);
@@ -441,8 +876,7 @@ void ADC_Module::setConversionSpeed(ADC_CONVERSION_SPEED speed) {
             break;
         case ADC_CONVERSION_SPEED::MED_SPEED:
             #ifdef ADC_TEENSY_4
-            atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADHSC);
-            atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADLPC);
+            atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADHSC | ADC_CFG_ADLPC, (uint32_t)0);
             #else
             atomic::clearBitFlag(adc_regs.CFG2, ADC_CFG2_ADHSC);
             atomic::clearBitFlag(adc_regs.CFG1, ADC_CFG1_ADLPC);
@@ -459,8 +893,7 @@ void ADC_Module::setConversionSpeed(ADC_CONVERSION_SPEED speed) {
         #endif
         case ADC_CONVERSION_SPEED::HIGH_SPEED:
             #ifdef ADC_TEENSY_4
-            atomic::setBitFlag(adc_regs.CFG, ADC_CFG_ADHSC);
-            atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADLPC);
+            atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADHSC | ADC_CFG_ADLPC, ADC_CFG_ADHSC);
             #else
             atomic::setBitFlag(adc_regs.CFG2, ADC_CFG2_ADHSC);
             atomic::clearBitFlag(adc_regs.CFG1, ADC_CFG1_ADLPC);
@@ -511,15 +944,14 @@ void ADC_Module::setConversionSpeed(ADC_CONVERSION_SPEED speed) {
 
         default:
             fail_flag |= ADC_ERROR::OTHER;
-            return;
+            return false;
     }
 
     if (is_adack) {
         // async clock source, independent of the bus clock
         #ifdef ADC_TEENSY_4
         atomic::setBitFlag(adc_regs.GC, ADC_GC_ADACKEN); // enable ADACK (takes max 5us to be ready)
-        atomic::setBitFlag(adc_regs.CFG, ADC_CFG_ADICLK(3)); // select ADACK as clock source
-        atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADIV(3)); // select no dividers
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADICLK(3) | ADC_CFG_ADIV(3), ADC_CFG_ADICLK(3)); // select ADACK as clock source, no dividers
         #else
         atomic::setBitFlag(adc_regs.CFG2, ADC_CFG2_ADACKEN); 
         atomic::setBitFlag(adc_regs.CFG1, ADC_CFG1_ADICLK(3));
@@ -530,8 +962,8 @@ void ADC_Module::setConversionSpeed(ADC_CONVERSION_SPEED speed) {
         // total speed can be: bus, bus/2, bus/4, bus/8 or bus/16.
         #ifdef ADC_TEENSY_4
         atomic::clearBitFlag(adc_regs.GC, ADC_GC_ADACKEN); // disable async
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADICLK(3), ADC_CFG1_speed & ADC_CFG_ADICLK(3)); // bus or bus/2
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADIV(3), ADC_CFG1_speed & ADC_CFG_ADIV(3)); // divisor for the clock source
+        // bus or bus/2 and divisor for the clock source
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADICLK(3) | ADC_CFG_ADIV(3), ADC_CFG1_speed);
         #else
         atomic::clearBitFlag(adc_regs.CFG2, ADC_CFG2_ADACKEN);
         atomic::changeBitFlag(adc_regs.CFG1, ADC_CFG1_ADICLK(3), ADC_CFG1_speed & ADC_CFG1_ADICLK(3));
@@ -540,7 +972,7 @@ void ADC_Module::setConversionSpeed(ADC_CONVERSION_SPEED speed) {
     }
 
     conversion_speed = speed;
-    calibrate();    
+    return true;
 }
 
 
@@ -560,36 +992,28 @@ void ADC_Module::setSamplingSpeed(ADC_SAMPLING_SPEED speed) {
     switch(speed) {
     #ifdef ADC_TEENSY_4
     case ADC_SAMPLING_SPEED::VERY_LOW_SPEED:
-        atomic::setBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP); // long sampling time enable
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(3));
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3), ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3)); // long sampling time enable
         break;
     case ADC_SAMPLING_SPEED::LOW_SPEED:
-        atomic::setBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP); // long sampling time enable
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(2));
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3), ADC_CFG_ADLSMP | ADC_CFG_ADSTS(2)); // long sampling time enable
         break;
     case ADC_SAMPLING_SPEED::LOW_MED_SPEED:
-        atomic::setBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP); // long sampling time enable
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(1));
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3), ADC_CFG_ADLSMP | ADC_CFG_ADSTS(1)); // long sampling time enable
         break;
     case ADC_SAMPLING_SPEED::MED_SPEED:
-        atomic::setBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP); // long sampling time enable
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(0));
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3), ADC_CFG_ADLSMP | ADC_CFG_ADSTS(0)); // long sampling time enable
         break;
     case ADC_SAMPLING_SPEED::MED_HIGH_SPEED:
-        atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP); // long sampling time disabled
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(3));
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(3)); // long sampling time disabled
         break;
     case ADC_SAMPLING_SPEED::HIGH_SPEED:
-        atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP); // long sampling time disabled
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(2));
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(2)); // long sampling time disabled
         break;
     case ADC_SAMPLING_SPEED::HIGH_VERY_HIGH_SPEED:
-        atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP); // long sampling time disabled
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(1));
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(1)); // long sampling time disabled
         break;
     case ADC_SAMPLING_SPEED::VERY_HIGH_SPEED:
-        atomic::clearBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP); // long sampling time disabled
-        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(0));
+        atomic::changeBitFlag(adc_regs.CFG, ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3), ADC_CFG_ADSTS(0)); // long sampling time disabled
         break;
     #else
     case ADC_SAMPLING_SPEED::VERY_LOW_SPEED:
@@ -681,6 +1105,59 @@ void ADC_Module::setAveraging(uint8_t num) {
 }
 
 
+/* Store the current conversion speed, sampling speed, averaging and resolution in a Profile
+*
+*/
+ADC_Module::Profile ADC_Module::captureProfile() {
+    if (calibrating) wait_for_cal();
+
+    Profile profile;
+    #ifdef ADC_TEENSY_4
+    profile.cfg = adc_regs.CFG & PROFILE_CFG_MASK;
+    profile.gc = adc_regs.GC & PROFILE_GC_MASK;
+    #else
+    profile.cfg1 = adc_regs.CFG1 & PROFILE_CFG1_MASK;
+    profile.cfg2 = adc_regs.CFG2 & PROFILE_CFG2_MASK;
+    profile.sc3 = adc_regs.SC3 & PROFILE_SC3_MASK;
+    #endif
+    profile.conversion_speed = conversion_speed;
+    profile.sampling_speed = sampling_speed;
+    profile.res_bits = analog_res_bits;
+    profile.max_val = analog_max_val;
+    profile.num_average = analog_num_average;
+    return profile;
+}
+
+/* Change the conversion speed, sampling speed, averaging and resolution to those of the profile
+*  Only one write per register, and a calibration if the conversion speed changes.
+*/
+void ADC_Module::applyProfile(const Profile &profile) {
+    if (calibrating) wait_for_cal();
+
+    ADC_DISABLE_IRQ();
+    #ifdef ADC_TEENSY_4
+    adc_regs.CFG = (adc_regs.CFG & ~PROFILE_CFG_MASK) | profile.cfg;
+    adc_regs.GC = (adc_regs.GC & ~PROFILE_GC_MASK) | profile.gc;
+    #else
+    adc_regs.CFG1 = (adc_regs.CFG1 & ~PROFILE_CFG1_MASK) | profile.cfg1;
+    adc_regs.CFG2 = (adc_regs.CFG2 & ~PROFILE_CFG2_MASK) | profile.cfg2;
+    // don't write 1 to CALF, it would clear a calibration error
+    adc_regs.SC3 = (adc_regs.SC3 & ~(PROFILE_SC3_MASK | ADC_SC3_CALF)) | profile.sc3;
+    #endif
+    ADC_ENABLE_IRQ();
+
+    sampling_speed = profile.sampling_speed;
+    analog_res_bits = profile.res_bits;
+    analog_max_val = profile.max_val;
+    analog_num_average = profile.num_average;
+
+    if (profile.conversion_speed != conversion_speed) {
+        conversion_speed = profile.conversion_speed;
+        calibrate(); // restored from the cache if this profile was calibrated before
+    }
+}
+
+
 /* Enable interrupts: An ADC Interrupt will be raised when the conversion is completed
 *  (including hardware averages and if the comparison (if any) is true).
 */
@@ -694,6 +1171,7 @@ void ADC_Module::enableInterrupts(void (*isr)(void), uint8_t priority) {
     #else
     atomic::setBitFlag(adc_regs.SC1A, ADC_SC1_AIEN);
     #endif
+    async_interrupt = false; // isr gets the conversion of startRead too
 
     attachInterruptVector(IRQ_ADC, isr);
     NVIC_SET_PRIORITY(IRQ_ADC, priority);
@@ -711,6 +1189,7 @@ void ADC_Module::disableInterrupts() {
     #else
     atomic::clearBitFlag(adc_regs.SC1A, ADC_SC1_AIEN);
     #endif
+    async_interrupt = false;
 
     NVIC_DISABLE_IRQ(IRQ_ADC);
 }
@@ -951,7 +1430,8 @@ bool ADC_Module::checkDifferentialPins(uint8_t pinP, uint8_t pinN) {
 // Starts a single-ended conversion on the pin (sets the mux correctly)
 // Doesn't do any of the checks on the pin
 // It doesn't change the continuous conversion bit
-void ADC_Module::startReadFast(uint8_t pin) {
+// The interrupt is enabled if enableInterrupts was called or interrupt is true
+void ADC_Module::startReadFast(uint8_t pin, bool interrupt) {
 
     // translate pin number to SC1A number, that also contains MUX a or b info.
     const uint8_t sc1a_pin = channel2sc1a[pin];
@@ -967,13 +1447,16 @@ void ADC_Module::startReadFast(uint8_t pin) {
     #endif
 
     // select pin for single-ended mode and start conversion, enable interrupts if requested
-    __disable_irq();
+    ADC_DISABLE_IRQ();
     #ifdef ADC_TEENSY_4
-    adc_regs.HC0 = (sc1a_pin&ADC_SC1A_CHANNELS) + interrupts_enabled*ADC_HC_AIEN;
+    adc_regs.HC0 = (sc1a_pin&ADC_SC1A_CHANNELS) + (interrupts_enabled || interrupt)*ADC_HC_AIEN;
     #else
-    adc_regs.SC1A = (sc1a_pin&ADC_SC1A_CHANNELS) + atomic::getBitFlag(adc_regs.SC1A, ADC_SC1_AIEN)*ADC_SC1_AIEN;
+    // the interrupt of startRead's conversion isn't the user's, don't keep it
+    adc_regs.SC1A = (sc1a_pin&ADC_SC1A_CHANNELS) + (userInterruptsEnabled() || interrupt)*ADC_SC1_AIEN;
     #endif
-    __enable_irq();
+    conversion_id[ADC_num]++;
+    ADC_TRACE_EVENT(CONVERSION_START, ADC_num, sc1a_pin&ADC_SC1A_CHANNELS);
+    ADC_ENABLE_IRQ();
 
 }
 
@@ -993,21 +1476,55 @@ void ADC_Module::startDifferentialFast(uint8_t pinP, uint8_t pinN) {
     }
     #endif // ADC_USE_PGA
 
-    __disable_irq();
-    adc_regs.SC1A = ADC_SC1_DIFF + (sc1a_pin&ADC_SC1A_CHANNELS) + atomic::getBitFlag(adc_regs.SC1A, ADC_SC1_AIEN)*ADC_SC1_AIEN;
-    __enable_irq();
+    ADC_DISABLE_IRQ();
+    adc_regs.SC1A = ADC_SC1_DIFF + (sc1a_pin&ADC_SC1A_CHANNELS) + userInterruptsEnabled()*ADC_SC1_AIEN;
+    conversion_id[ADC_num]++;
+    ADC_TRACE_EVENT(CONVERSION_START, ADC_num, ADC_SC1_DIFF + (sc1a_pin&ADC_SC1A_CHANNELS));
+    ADC_ENABLE_IRQ();
 
 }
 #endif
 
 
+/* Saves the state of the ADC and stops the conversion in progress, so another one can use the ADC.
+*  A stream (continuous mode, hardware trigger or DMA) also has those, the comparison and the interrupt disabled,
+*  so its triggers, DMA and isr don't take the result of the new conversion. resumeStream restores everything.
+*/
+uint8_t ADC_Module::suspendStream(ADC_Config *config) {
+    ADC_DISABLE_IRQ();
+    const bool streaming = isStreaming();
+    const uint8_t wasADCInUse = isConverting() || streaming;
+    if(wasADCInUse) {
+        saveConfig(config);
+        ADC_TRACE_EVENT(PREEMPT, ADC_num, streaming);
+        // abort the conversion, the interrupt is kept only if it doesn't belong to a stream or to startRead
+        #ifdef ADC_TEENSY_4
+        adc_regs.HC0 = ADC_SC1A_PIN_INVALID + (!streaming && userInterruptsEnabled())*ADC_HC_AIEN;
+        #else
+        adc_regs.SC1A = ADC_SC1A_PIN_INVALID + (!streaming && userInterruptsEnabled())*ADC_SC1_AIEN;
+        #endif
+        if(streaming) {
+            #ifdef ADC_TEENSY_4
+            adc_regs.CFG &= ~ADC_CFG_ADTRG;
+            adc_regs.GC &= ~(ADC_GC_ADCO | ADC_GC_DMAEN | ADC_GC_ACFE);
+            #else
+            adc_regs.SC2 &= ~(ADC_SC2_ADTRG | ADC_SC2_DMAEN | ADC_SC2_ACFE);
+            adc_regs.SC3 &= ~ADC_SC3_ADCO;
+            #endif
+        }
+    }
+    ADC_ENABLE_IRQ();
+    return wasADCInUse;
+}
+
+
 //////////////// BLOCKING CONVERSION METHODS //////////////////
 /*
     This methods are implemented like this:
 
     1. Check that the pin is correct
     2. if calibrating, wait for it to finish before modifiying any ADC register
-    3. Check if we're interrupting a measurement, if so store the settings.
+    3. Check if we're interrupting a measurement or a stream, if so store the settings and stop it.
     4. Disable continuous conversion mode and start the current measurement
     5. Wait until it's done, and check whether the comparison (if any) was succesful.
     6. Get the result.
@@ -1021,7 +1538,7 @@ void ADC_Module::startDifferentialFast(uint8_t pinP, uint8_t pinN) {
 * If a comparison has been set up and fails, it will return ADC_ERROR_VALUE.
 * Set the resolution, number of averages and voltage reference using the appropriate functions.
 */
-int ADC_Module::analogRead(uint8_t pin) {
+int ADC_Module::analogRead(uint8_t pin, ADC_PRIORITY priority) {
 
     //digitalWriteFast(LED_BUILTIN, HIGH);
 
@@ -1031,6 +1548,12 @@ int ADC_Module::analogRead(uint8_t pin) {
         return ADC_ERROR_VALUE;
     }
 
+    // don't interrupt a more important stream
+    if(!canPreempt(priority)) {
+        fail_flag |= ADC_ERROR::PREEMPT;
+        return ADC_ERROR_VALUE;
+    }
+
     // increase the counter of measurements
     num_measurements++;
 
@@ -1040,18 +1563,9 @@ int ADC_Module::analogRead(uint8_t pin) {
 
     //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN));
 
-    // check if we are interrupting a measurement, store setting if so.
-    // vars to save the current state of the ADC in case it's in use
+    // check if we are interrupting a measurement or a stream, store its settings and stop it if so.
     ADC_Config old_config = {};
-    const uint8_t wasADCInUse = isConverting(); // is the ADC running now?
-
-    if(wasADCInUse) { // this means we're interrupting a conversion
-        // save the current conversion config, we don't want any other interrupts messing up the configs
-        __disable_irq();
-        //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
-        saveConfig(&old_config);
-        __enable_irq();
-    }
+    const uint8_t wasADCInUse = suspendStream(&old_config);
 
 
     // no continuous mode
@@ -1066,21 +1580,20 @@ int ADC_Module::analogRead(uint8_t pin) {
 
     // it's done, check if the comparison (if any) was true
     int32_t result;
-    __disable_irq(); // make sure nothing interrupts this part
+    ADC_DISABLE_IRQ(); // make sure nothing interrupts this part
     if (isComplete()) { // conversion succeded
-        result = (uint16_t)readSingle();
+        result = (uint16_t)analogReadContinuous();
+        ADC_TRACE_EVENT(CONVERSION_COMPLETE, ADC_num, result);
     } else { // comparison was false
         fail_flag |= ADC_ERROR::COMPARISON;
+        ADC_TRACE_EVENT(COMPARISON_FAILED, ADC_num, 0);
         result = ADC_ERROR_VALUE;
     }
-    __enable_irq();
+    ADC_ENABLE_IRQ();
 
     // if we interrupted a conversion, set it again
     if (wasADCInUse) {
-        //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
-        __disable_irq();
-        loadConfig(&old_config);
-        __enable_irq();
+        resumeStream(&old_config);
     }
 
     num_measurements--;
@@ -1089,17 +1602,108 @@ int ADC_Module::analogRead(uint8_t pin) {
 } // analogRead
 
 
-#if ADC_DIFF_PAIRS > 0
-/* Reads the differential analog value of two pins (pinP - pinN)
-* It waits until the value is read and then returns the result
-* If a comparison has been set up and fails, it will return ADC_ERROR_DIFF_VALUE
-* Set the resolution, number of averages and voltage reference using the appropriate functions
+/* Reads several pins, one after the other.
+* Each conversion is started as soon as the previous result is read, the next pin is looked up
+* and the previous result stored while the ADC converts.
 */
-int ADC_Module::analogReadDifferential(uint8_t pinP, uint8_t pinN) {
+bool ADC_Module::analogReadBatch(const uint8_t *pins, int *results, uint8_t num_pins) {
 
-    if(!checkDifferentialPins(pinP, pinN)) {
-        fail_flag |= ADC_ERROR::WRONG_PIN;
-        return ADC_ERROR_VALUE;   // all others are invalid
+    // check all pins before starting
+    for(uint8_t i=0; i<num_pins; i++) {
+        if(!checkPin(pins[i])) {
+            fail_flag |= ADC_ERROR::WRONG_PIN;
+            return false;
+        }
+    }
+    if(num_pins == 0) {
+        return true;
+    }
+
+    // don't interrupt a more important stream
+    if(!canPreempt(ADC_PRIORITY::NORMAL)) {
+        fail_flag |= ADC_ERROR::PREEMPT;
+        return false;
+    }
+
+    // increase the counter of measurements
+    num_measurements++;
+
+    if (calibrating) wait_for_cal();
+
+    // check if we are interrupting a measurement or a stream, store its settings and stop it if so.
+    ADC_Config old_config = {};
+    const uint8_t wasADCInUse = suspendStream(&old_config);
+
+    // no continuous mode
+    singleMode();
+
+    startFast(adc_regs, channel2sc1a[pins[0]], ADC_num);
+    for(uint8_t i=0; i<num_pins; i++) {
+        const bool last = (i == num_pins-1);
+        // translate the next pin while this one converts
+        const uint8_t next_sc1a_pin = last ? ADC_SC1A_PIN_INVALID : channel2sc1a[pins[i+1]];
+
+        const int result = waitFast(adc_regs);
+        if(!last) {
+            startFast(adc_regs, next_sc1a_pin, ADC_num);
+        }
+
+        // the ADC is already converting the next pin
+        if(result == ADC_ERROR_VALUE) {
+            fail_flag |= ADC_ERROR::COMPARISON;
+            ADC_TRACE_EVENT(COMPARISON_FAILED, ADC_num, 0);
+        }
+        results[i] = result;
+    }
+
+    // if we interrupted a conversion, set it again
+    if (wasADCInUse) {
+        resumeStream(&old_config);
+    }
+
+    num_measurements--;
+    return true;
+}
+
+/* Prepares a pin to be read many times with PreparedChannel::read().
+* The pin is checked and translated to the SC1A/HC0 value only once.
+*/
+ADC_Module::PreparedChannel ADC_Module::prepareChannel(uint8_t pin) {
+    PreparedChannel prepared = {};
+
+    // check whether the pin is correct
+    if(!checkPin(pin)) {
+        fail_flag |= ADC_ERROR::WRONG_PIN;
+        return prepared;
+    }
+
+    if (calibrating) wait_for_cal();
+
+    prepared.regs = &adc_regs;
+    // translate pin number to SC1A number, that also contains MUX a or b info.
+    prepared.sc1a_pin = channel2sc1a[pin];
+    prepared.adc_num = ADC_num;
+    return prepared;
+}
+
+
+#if ADC_DIFF_PAIRS > 0
+/* Reads the differential analog value of two pins (pinP - pinN)
+* It waits until the value is read and then returns the result
+* If a comparison has been set up and fails, it will return ADC_ERROR_DIFF_VALUE
+* Set the resolution, number of averages and voltage reference using the appropriate functions
+*/
+int ADC_Module::analogReadDifferential(uint8_t pinP, uint8_t pinN, ADC_PRIORITY priority) {
+
+    if(!checkDifferentialPins(pinP, pinN)) {
+        fail_flag |= ADC_ERROR::WRONG_PIN;
+        return ADC_ERROR_VALUE;   // all others are invalid
+    }
+
+    // don't interrupt a more important stream
+    if(!canPreempt(priority)) {
+        fail_flag |= ADC_ERROR::PREEMPT;
+        return ADC_ERROR_VALUE;
     }
 
     // increase the counter of measurements
@@ -1111,16 +1715,9 @@ int ADC_Module::analogReadDifferential(uint8_t pinP, uint8_t pinN) {
 
     uint8_t res = getResolution();
 
-    // vars to saved the current state of the ADC in case it's in use
+    // check if we are interrupting a measurement or a stream, store its settings and stop it if so.
     ADC_Config old_config = {};
-    uint8_t wasADCInUse = isConverting(); // is the ADC running now?
-
-    if(wasADCInUse) { // this means we're interrupting a conversion
-        // save the current conversion config, we don't want any other interrupts messing up the configs
-        __disable_irq();
-        saveConfig(&old_config);
-        __enable_irq();
-    }
+    const uint8_t wasADCInUse = suspendStream(&old_config);
 
     // no continuous mode
     singleMode();
@@ -1135,23 +1732,23 @@ int ADC_Module::analogReadDifferential(uint8_t pinP, uint8_t pinN) {
 
     // it's done, check if the comparison (if any) was true
     int32_t result;
-    __disable_irq(); // make sure nothing interrupts this part
+    ADC_DISABLE_IRQ(); // make sure nothing interrupts this part
     if (isComplete()) { // conversion succeded
-        result = (int16_t)(int32_t)readSingle(); // cast to 32 bits
+        result = (int16_t)(int32_t)analogReadContinuous(); // cast to 32 bits
+        ADC_TRACE_EVENT(CONVERSION_COMPLETE, ADC_num, result);
         if(res==16) { // 16 bit differential is actually 15 bit + 1 bit sign
             result *= 2; // multiply by 2 as if it were really 16 bits, so that getMaxValue gives a correct value.
         }
     } else { // comparison was false
         result = ADC_ERROR_VALUE;
         fail_flag |= ADC_ERROR::COMPARISON;
+        ADC_TRACE_EVENT(COMPARISON_FAILED, ADC_num, 0);
     }
-    __enable_irq();
+    ADC_ENABLE_IRQ();
 
     // if we interrupted a conversion, set it again
     if (wasADCInUse) {
-        __disable_irq();
-        loadConfig(&old_config);
-        __enable_irq();
+        resumeStream(&old_config);
     }
 
     num_measurements--;
@@ -1167,7 +1764,8 @@ int ADC_Module::analogReadDifferential(uint8_t pinP, uint8_t pinN) {
 
     1. Check that the pin is correct
     2. if calibrating, wait for it to finish before modifiying any ADC register
-    3. Check if we're interrupting a measurement, if so store the settings (in a member of the class, so it can be accessed).
+    3. Check if we're interrupting a measurement or a stream, if so store the settings (in a member of the class, so it can be accessed)
+       and stop it. readSingle() restores them.
     4. Disable continuous conversion mode and start the current measurement
 
     The fast methods only do step 4.
@@ -1175,11 +1773,37 @@ int ADC_Module::analogReadDifferential(uint8_t pinP, uint8_t pinN) {
 */
 
 
+/* Waits for the calibration and suspends what the ADC is doing, unless it's more important than priority.
+*  readSingle restores it.
+*/
+bool ADC_Module::prepareSingleRead(ADC_PRIORITY priority) {
+
+    if (calibrating) wait_for_cal();
+
+    // a DMA stream that isn't converting yet is being set up (init DMA, startSingleRead, start the timer):
+    // this conversion starts it, there's nothing to suspend
+    const bool arming = isArmedStream();
+
+    // don't interrupt a more important stream
+    if(!arming && !canPreempt(priority)) {
+        fail_flag |= ADC_ERROR::PREEMPT;
+        return false;
+    }
+
+    // save the current state of the ADC in case it's in use, readSingle will restore it
+    adcWasInUse = arming ? 0 : suspendStream(&adc_config);
+
+    // no continuous mode
+    singleMode();
+
+    return true;
+}
+
 /* Starts an analog measurement on the pin.
 *  It returns inmediately, read value with readSingle().
 *  If the pin is incorrect it returns false.
 */
-bool ADC_Module::startSingleRead(uint8_t pin) {
+bool ADC_Module::startSingleRead(uint8_t pin, ADC_PRIORITY priority) {
 
     // check whether the pin is correct
     if(!checkPin(pin)) {
@@ -1187,21 +1811,10 @@ bool ADC_Module::startSingleRead(uint8_t pin) {
         return false;
     }
 
-    if (calibrating) wait_for_cal();
-
-    // save the current state of the ADC in case it's in use
-    adcWasInUse = isConverting(); // is the ADC running now?
-
-    if(adcWasInUse) { // this means we're interrupting a conversion
-        // save the current conversion config, the adc isr will restore the adc
-        __disable_irq();
-        saveConfig(&adc_config);
-        __enable_irq();
+    if(!prepareSingleRead(priority)) { // it sets fail_flag
+        return false;
     }
 
-    // no continuous mode
-    singleMode();
-
     // start measurement
     startReadFast(pin);
 
@@ -1215,7 +1828,7 @@ bool ADC_Module::startSingleRead(uint8_t pin) {
 * Incorrect pins will return false.
 * Set the resolution, number of averages and voltage reference using the appropriate functions
 */
-bool ADC_Module::startSingleDifferential(uint8_t pinP, uint8_t pinN) {
+bool ADC_Module::startSingleDifferential(uint8_t pinP, uint8_t pinN, ADC_PRIORITY priority) {
 
     if(!checkDifferentialPins(pinP, pinN)) {
         fail_flag |= ADC_ERROR::WRONG_PIN;
@@ -1224,28 +1837,367 @@ bool ADC_Module::startSingleDifferential(uint8_t pinP, uint8_t pinN) {
 
     // check for calibration before setting channels,
     // because conversion will start as soon as we write to adc_regs.SC1A
-    if (calibrating) wait_for_cal();
+    if(!prepareSingleRead(priority)) { // it sets fail_flag
+        return false;
+    }
+
+    // start the conversion
+    startDifferentialFast(pinP, pinN);
+
+    return true;
+}
+#endif
+
 
-    // vars to saved the current state of the ADC in case it's in use
-    adcWasInUse = isConverting(); // is the ADC running now?
+/* Starts a single-ended conversion and returns a handle to poll it
+*  If nothing else uses the ADC interrupt, the conversion raises it and asyncISR reads the result.
+*/
+ADC_Module::AsyncRead ADC_Module::startRead(uint8_t pin) {
+    AsyncRead handle;
 
-    if(adcWasInUse) { // this means we're interrupting a conversion
-        // save the current conversion config, we don't want any other interrupts messing up the configs
-        __disable_irq();
-        saveConfig(&adc_config);
-        __enable_irq();
+    // check whether the pin is correct
+    if(!checkPin(pin)) {
+        fail_flag |= ADC_ERROR::WRONG_PIN;
+        return handle;
     }
 
-    // no continuous mode
-    singleMode();
+    // the conversion of the previous startRead gives the interrupt back, its handle (and coroutine) fail
+    stopAsync();
+    resumeAwaiting();
 
-    // start the conversion
-    startDifferentialFast(pinP, pinN);
+    if(!prepareSingleRead(ADC_PRIORITY::NORMAL)) { // it sets fail_flag
+        return handle;
+    }
+
+    // the interrupt can't take the result from the user's isr, the DMA or a comparison
+    #ifdef ADC_TEENSY_4
+    const bool comparing = atomic::getBitFlag(adc_regs.GC, ADC_GC_ACFE);
+    #else
+    const bool comparing = atomic::getBitFlag(adc_regs.SC2, ADC_SC2_ACFE);
+    #endif
+    const bool interrupt = !userInterruptsEnabled() && !isDMAEnabled() && !comparing;
+
+    if (interrupt) {
+        queue_modules[ADC_num] = this;
+        async_done = false;
+        async_interrupt = true;
+        #ifdef ADC_DUAL_ADCS
+        attachInterruptVector(IRQ_ADC, ADC_num ? async_isr1 : async_isr0);
+        #else
+        attachInterruptVector(IRQ_ADC, async_isr0);
+        #endif
+        NVIC_ENABLE_IRQ(IRQ_ADC);
+    }
+    startReadFast(pin, interrupt);
+    if (interrupt) {
+        async_id = conversion_id[ADC_num];
+    }
+
+    handle.adc = this;
+    handle.pin = pin;
+    handle.id = conversion_id[ADC_num];
+    handle.interrupt = interrupt;
+    handle.state = AsyncRead::State::PENDING;
+    return handle;
+}
+
+/* Is the result available? Read it if the conversion just finished
+*
+*/
+bool ADC_Module::AsyncRead::ready() {
+    if (state != State::PENDING) {
+        return true;
+    }
 
+    if (interrupt) { // asyncISR reads the result
+        bool failed = false;
+        ADC_DISABLE_IRQ();
+        if ((adc->async_id == id) && adc->async_done) {
+            value = adc->async_value;
+        } else if ((adc->async_id == id) && adc->isAsyncConversion() && (adc->isConverting() || adc->isComplete())) {
+            ADC_ENABLE_IRQ();
+            return false; // the interrupt hasn't come yet
+        } else { // another conversion replaced it, or the comparison was false
+            failed = true;
+            value = ADC_ERROR_VALUE;
+        }
+        ADC_ENABLE_IRQ();
+        if (failed && (adc->async_id == id)) {
+            adc->stopAsync(); // the interrupt won't come, give it back
+        }
+        state = State::DONE;
+        return true;
+    }
+
+    if (adc->conversion_id[adc->ADC_num] != id) { // another conversion started, the result isn't ours
+        state = State::DONE;
+        value = ADC_ERROR_VALUE;
+        return true;
+    }
+    if (adc->isConverting()) {
+        return false;
+    }
+
+    ADC_DISABLE_IRQ(); // make sure nothing interrupts this part
+    if (adc->isComplete()) { // conversion succeded
+        value = (uint16_t)adc->readSingle(); // it restarts the conversion we interrupted, if any
+    } else { // comparison was false
+        adc->fail_flag |= ADC_ERROR::COMPARISON;
+        ADC_TRACE_EVENT(COMPARISON_FAILED, adc->ADC_num, 0);
+        value = ADC_ERROR_VALUE;
+        // if we interrupted a conversion, set it again
+        if (adc->adcWasInUse) {
+            adc->loadConfig(&adc->adc_config);
+            adc->adcWasInUse = 0;
+            ADC_TRACE_EVENT(RESUME, adc->ADC_num, 0);
+        }
+    }
+    ADC_ENABLE_IRQ();
+
+    state = State::DONE;
     return true;
 }
+
+/* Returns the result, waiting for it if needed
+*
+*/
+int ADC_Module::AsyncRead::get() {
+    while (!ready()) {
+        yield();
+    }
+    return value;
+}
+
+/* Stops the conversion, if it's still ours
+*
+*/
+void ADC_Module::AsyncRead::cancel() {
+    if (state != State::PENDING) {
+        return;
+    }
+    if (interrupt) {
+        if (adc->async_id == id) {
+            adc->stopAsync();
+            adc->resumeAwaiting(); // a coroutine awaiting a copy of this handle fails
+        }
+    } else {
+        ADC_DISABLE_IRQ();
+        if ((adc->conversion_id[adc->ADC_num] == id) && adc->isConverting()) {
+            #ifdef ADC_TEENSY_4
+            adc->adc_regs.HC0 = ADC_SC1A_PIN_INVALID; // stop the conversion
+            #else
+            adc->adc_regs.SC1A = ADC_SC1A_PIN_INVALID;
+            #endif
+            if (adc->adcWasInUse) {
+                adc->loadConfig(&adc->adc_config);
+                adc->adcWasInUse = 0;
+                ADC_TRACE_EVENT(RESUME, adc->ADC_num, 0);
+            }
+        }
+        ADC_ENABLE_IRQ();
+    }
+    state = State::DONE;
+    value = ADC_ERROR_VALUE;
+}
+
+#if defined(__cpp_impl_coroutine)
+/* Suspends the coroutine until asyncISR resumes it.
+*  Without the interrupt nothing would resume it, so it waits for the result and continues inline.
+*/
+bool ADC_Module::AsyncRead::await_suspend(std::coroutine_handle<> coroutine) {
+    if (!interrupt) {
+        get();
+        return false; // don't suspend
+    }
+    ADC_DISABLE_IRQ();
+    const bool suspend = (adc->async_id == id) && !adc->async_done && adc->isAsyncConversion();
+    if (suspend) {
+        adc->async_coroutine = coroutine.address();
+    }
+    ADC_ENABLE_IRQ();
+    return suspend; // otherwise await_resume has the result (or the error) now
+}
 #endif
 
+/* The conversion started by startRead is complete: read it, restart what it interrupted
+*  and resume the coroutine that awaits it.
+*/
+void ADC_Module::asyncISR() {
+    const int value = (uint16_t)analogReadContinuous(); // single-ended, so unsigned. It clears the interrupt flag
+    ADC_TRACE_EVENT(CONVERSION_COMPLETE, ADC_num, value);
+
+    // the interrupt was only for this conversion
+    NVIC_DISABLE_IRQ(IRQ_ADC);
+    async_interrupt = false;
+    if (adcWasInUse) {
+        loadConfig(&adc_config);
+        adcWasInUse = 0;
+        ADC_TRACE_EVENT(RESUME, ADC_num, 0);
+    } else {
+        #ifdef ADC_TEENSY_4
+        adc_regs.HC0 = ADC_SC1A_PIN_INVALID; // clear AIEN
+        #else
+        adc_regs.SC1A = ADC_SC1A_PIN_INVALID;
+        #endif
+    }
+    async_value = value;
+    async_done = true;
+
+    resumeAwaiting();
+
+    #if defined(__IMXRT1062__)  // Teensy 4.0
+    asm("DSB");
+    #endif
+}
+
+/* Stops the conversion started by startRead if it's still in the ADC, restarts what it interrupted
+*  and frees the interrupt. The handle fails.
+*/
+void ADC_Module::stopAsync() {
+    ADC_DISABLE_IRQ();
+    if (async_interrupt) {
+        if (isAsyncConversion()) { // converting or waiting for the isr
+            #ifdef ADC_TEENSY_4
+            adc_regs.HC0 = ADC_SC1A_PIN_INVALID; // stop the conversion and clear AIEN
+            #else
+            adc_regs.SC1A = ADC_SC1A_PIN_INVALID;
+            #endif
+            if (adcWasInUse) {
+                loadConfig(&adc_config);
+                adcWasInUse = 0;
+                ADC_TRACE_EVENT(RESUME, ADC_num, 0);
+            }
+        }
+        async_interrupt = false;
+        NVIC_DISABLE_IRQ(IRQ_ADC);
+        NVIC_CLEAR_PENDING(IRQ_ADC);
+    }
+    ADC_ENABLE_IRQ();
+}
+
+/* Resumes the coroutine awaiting the conversion of startRead, if any
+*
+*/
+void ADC_Module::resumeAwaiting() {
+    #if defined(__cpp_impl_coroutine)
+    ADC_DISABLE_IRQ();
+    void *coroutine = async_coroutine;
+    async_coroutine = nullptr;
+    ADC_ENABLE_IRQ();
+    if (coroutine) {
+        std::coroutine_handle<>::from_address(coroutine).resume();
+    }
+    #endif
+}
+
+
+///////////// QUEUED CONVERSION METHODS ////////////
+
+// the module whose queue or startRead conversion has the interrupt, see queue_isr0 and async_isr0
+ADC_Module* ADC_Module::queue_modules[ADC_NUM_ADCS];
+
+/* Adds the conversion of a pin to the queue, the conversion starts now if the queue was empty
+*
+*/
+bool ADC_Module::submit(uint8_t pin, ReadCallback callback, void *context) {
+
+    // check whether the pin is correct
+    if(!checkPin(pin)) {
+        fail_flag |= ADC_ERROR::WRONG_PIN;
+        return false;
+    }
+
+    if (calibrating) wait_for_cal();
+
+    ADC_DISABLE_IRQ();
+    if (queue_count == ADC_QUEUE_SIZE) { // full
+        ADC_ENABLE_IRQ();
+        return false;
+    }
+    // the queue takes over the ADC and its interrupt when it starts, don't abort something else
+    if ((queue_count == 0) && (isStreaming() || isConverting() || isComplete() || userInterruptsEnabled())) {
+        ADC_ENABLE_IRQ();
+        fail_flag |= ADC_ERROR::PREEMPT;
+        return false;
+    }
+    QueuedRead &request = read_queue[(queue_head + queue_count) % ADC_QUEUE_SIZE];
+    request.pin = pin;
+    request.callback = callback;
+    request.context = context;
+    queue_count++;
+    const bool start = (queue_count == 1); // otherwise the ISR will start it
+    ADC_ENABLE_IRQ();
+
+    if (start) {
+        startQueue();
+    }
+    return true;
+}
+
+/* Removes all conversions from the queue and stops the current one
+*
+*/
+void ADC_Module::clearQueue() {
+    ADC_DISABLE_IRQ();
+    const bool was_running = (queue_count > 0);
+    queue_count = 0;
+    ADC_ENABLE_IRQ();
+
+    if (was_running) {
+        disableInterrupts();
+        #ifdef ADC_TEENSY_4
+        adc_regs.HC0 = ADC_SC1A_PIN_INVALID; // stop the conversion
+        #else
+        adc_regs.SC1A = ADC_SC1A_PIN_INVALID;
+        #endif
+    }
+}
+
+/* Starts the first conversion of the queue, with the ADC interrupt
+*
+*/
+void ADC_Module::startQueue() {
+    queue_modules[ADC_num] = this;
+    #ifdef ADC_DUAL_ADCS
+    enableInterrupts(ADC_num ? queue_isr1 : queue_isr0);
+    #else
+    enableInterrupts(queue_isr0);
+    #endif
+
+    singleMode();
+    startReadFast(read_queue[queue_head].pin);
+}
+
+/* The conversion of the first element of the queue is complete:
+*  read it, start the next one and call the callback.
+*/
+void ADC_Module::queueISR() {
+    const int value = (uint16_t)analogReadContinuous(); // single-ended, so unsigned. It clears the interrupt flag
+    ADC_TRACE_EVENT(CONVERSION_COMPLETE, ADC_num, value);
+
+    if (queue_count == 0) { // clearQueue was called
+        return;
+    }
+    const QueuedRead request = read_queue[queue_head];
+    queue_head = (queue_head + 1) % ADC_QUEUE_SIZE;
+    queue_count--;
+
+    // start the next conversion before the callback, so the ADC doesn't wait for it
+    if (queue_count > 0) {
+        startReadFast(read_queue[queue_head].pin);
+    } else {
+        disableInterrupts();
+    }
+
+    if (request.callback) {
+        request.callback(value, request.context);
+    }
+
+    #if defined(__IMXRT1062__)  // Teensy 4.0
+    asm("DSB");
+    #endif
+}
+
 
 ///////////// CONTINUOUS CONVERSION METHODS ////////////
 /*
@@ -1303,15 +2255,7 @@ bool ADC_Module::startContinuousDifferential(uint8_t pinP, uint8_t pinN) {
     // because conversion will start as soon as we write to adc_regs.SC1A
     if (calibrating) wait_for_cal();
 
-    // save the current state of the ADC in case it's in use
-    uint8_t wasADCInUse = isConverting(); // is the ADC running now?
-
-    if(wasADCInUse) { // this means we're interrupting a conversion
-        // save the current conversion config, we don't want any other interrupts messing up the configs
-        __disable_irq();
-        saveConfig(&adc_config);
-        __enable_irq();
-    }
+    // like startContinuous, the new stream replaces whatever the ADC was doing, nothing is restored later
 
     // set continuous mode
     continuousMode();
@@ -1350,21 +2294,27 @@ void ADC_Module::stopContinuous() {
 //////////// PDB ////////////////
 #ifdef ADC_USE_PDB
 
-// frequency in Hz
-void ADC_Module::startPDB(uint32_t freq) {
-    if (!(SIM_SCGC6 & SIM_SCGC6_PDB)) { // setup PDB
-        SIM_SCGC6 |= SIM_SCGC6_PDB; // enable pdb clock
-    }
+// PDB pretrigger settings, the suffix is the bit of the pretrigger: _1 is pretrigger 0 (SC1A), _2 is pretrigger 1 (SC1B)
+constexpr uint32_t PDB_CHnC1_TOS_1 = 0x0100;
+constexpr uint32_t PDB_CHnC1_EN_1 = 0x01;
+constexpr uint32_t PDB_CHnC1_TOS_2 = 0x0200;
+constexpr uint32_t PDB_CHnC1_EN_2 = 0x02;
+constexpr uint32_t PDB_CHnC1_BB_2 = 0x020000; // pretrigger 1 starts as soon as the conversion of pretrigger 0 is done
 
-    if(freq>ADC_F_BUS) return; // too high
-    if(freq<1) return; // too low
+//                                   software trigger    enable PDB     PDB interrupt  continuous mode load immediately
+constexpr uint32_t ADC_PDB_CONFIG = PDB_SC_TRGSEL(15) | PDB_SC_PDBEN | PDB_SC_PDBIE | PDB_SC_CONT |   PDB_SC_LDMOD(0);
+
+// calculate the PDB settings for the frequency, return false if it's not possible
+bool ADC_Module::getPDBSettings(uint32_t freq, uint32_t &mod, uint8_t &prescaler, uint8_t &mult) {
+    if(freq>ADC_F_BUS) return false; // too high
+    if(freq<1) return false; // too low
 
     // mod will have to be a 16 bit value
     // we detect if it's higher than 0xFFFF and scale it back accordingly.
-    uint32_t mod = (ADC_F_BUS / freq);
+    mod = (ADC_F_BUS / freq);
 
-    uint8_t prescaler = 0; // from 0 to 7: factor of 1, 2, 4, 8, 16, 32, 64 or 128
-    uint8_t mult = 0; // from 0 to 3, factor of 1, 10, 20 or 40
+    prescaler = 0; // from 0 to 7: factor of 1, 2, 4, 8, 16, 32, 64 or 128
+    mult = 0; // from 0 to 3, factor of 1, 10, 20 or 40
 
     // if mod is too high we need to use prescaler and mult to bring it down to a 16 bit number
     const uint32_t min_level = 0xFFFF;
@@ -1424,7 +2374,7 @@ void ADC_Module::startPDB(uint32_t freq) {
                 mult = 3;
         }
         else { // frequency too low
-            return;
+            return false;
         }
 
         mod >>= prescaler;
@@ -1434,13 +2384,20 @@ void ADC_Module::startPDB(uint32_t freq) {
         }
     }
 
-    setHardwareTrigger(); // trigger ADC with hardware
+    return true;
+}
 
-    //                                   software trigger    enable PDB     PDB interrupt  continuous mode load immediately
-    constexpr uint32_t ADC_PDB_CONFIG = PDB_SC_TRGSEL(15) | PDB_SC_PDBEN | PDB_SC_PDBIE | PDB_SC_CONT |   PDB_SC_LDMOD(0);
+// frequency in Hz
+void ADC_Module::startPDB(uint32_t freq) {
+    if (!(SIM_SCGC6 & SIM_SCGC6_PDB)) { // setup PDB
+        SIM_SCGC6 |= SIM_SCGC6_PDB; // enable pdb clock
+    }
 
-    constexpr uint32_t PDB_CHnC1_TOS_1 = 0x0100;
-    constexpr uint32_t PDB_CHnC1_EN_1 = 0x01;
+    uint32_t mod;
+    uint8_t prescaler, mult;
+    if(!getPDBSettings(freq, mod, prescaler, mult)) return;
+
+    setHardwareTrigger(); // trigger ADC with hardware
 
     PDB0_IDLY = 1; // the pdb interrupt happens when IDLY is equal to CNT+1
 
@@ -1450,18 +2407,132 @@ void ADC_Module::startPDB(uint32_t freq) {
 
     PDB0_SC = ADC_PDB_CONFIG | PDB_SC_PRESCALER(prescaler) | PDB_SC_MULT(mult) | PDB_SC_SWTRIG; // start the counter!
 
+    ADC_TRACE_EVENT(TIMER_START, ADC_num, freq);
+
     PDB0_CHnC1 = PDB_CHnC1_TOS_1 | PDB_CHnC1_EN_1; // enable pretrigger 0 (SC1A)
 
     //NVIC_ENABLE_IRQ(IRQ_PDB);
 
 }
 
+// frequency in Hz, delayB in 1/256 of the period
+bool ADC_Module::startPDBPingPong(uint8_t pinA, uint8_t pinB, uint32_t freq, uint8_t delayB) {
+    if(!checkPin(pinA) || !checkPin(pinB)) {
+        fail_flag |= ADC_ERROR::WRONG_PIN;
+        return false;
+    }
+
+    const uint8_t sc1a_pinA = channel2sc1a[pinA];
+    const uint8_t sc1a_pinB = channel2sc1a[pinB];
+
+    // SC1A and SC1B share the mux selection
+    if((sc1a_pinA^sc1a_pinB)&ADC_SC1A_PIN_MUX) {
+        fail_flag |= ADC_ERROR::WRONG_PIN;
+        return false;
+    }
+
+    uint32_t mod;
+    uint8_t prescaler, mult;
+    if(!getPDBSettings(freq, mod, prescaler, mult)) {
+        fail_flag |= ADC_ERROR::OTHER;
+        return false;
+    }
+
+    if (!(SIM_SCGC6 & SIM_SCGC6_PDB)) { // setup PDB
+        SIM_SCGC6 |= SIM_SCGC6_PDB; // enable pdb clock
+    }
+
+    if (calibrating) wait_for_cal();
+
+    singleMode();
+    setHardwareTrigger(); // trigger ADC with hardware, writing to SC1n won't start a conversion
+
+    if(sc1a_pinA&ADC_SC1A_PIN_MUX) { // mux a
+        atomic::clearBitFlag(adc_regs.CFG2, ADC_CFG2_MUXSEL);
+    } else { // mux b
+        atomic::setBitFlag(adc_regs.CFG2, ADC_CFG2_MUXSEL);
+    }
+
+    // only the second conversion raises the interrupt (if enableInterrupts was called), read both RA and RB in the isr.
+    ADC_DISABLE_IRQ();
+    const uint32_t aien = userInterruptsEnabled()*ADC_SC1_AIEN;
+    adc_regs.SC1A = (sc1a_pinA&ADC_SC1A_CHANNELS);
+    adc_regs.SC1B = (sc1a_pinB&ADC_SC1A_CHANNELS) + aien;
+    ADC_ENABLE_IRQ();
+
+    PDB0_IDLY = 1; // the pdb interrupt happens when IDLY is equal to CNT+1
+
+    PDB0_MOD = (uint16_t)(mod-1);
+
+    PDB0_CHnDLY0 = 0;
+    PDB0_CHnDLY1 = (uint16_t)((mod*delayB) >> 8);
+
+    PDB0_SC = ADC_PDB_CONFIG | PDB_SC_PRESCALER(prescaler) | PDB_SC_MULT(mult) | PDB_SC_LDOK; // load all new values
+
+    PDB0_SC = ADC_PDB_CONFIG | PDB_SC_PRESCALER(prescaler) | PDB_SC_MULT(mult) | PDB_SC_SWTRIG; // start the counter!
+
+    ADC_TRACE_EVENT(TIMER_START, ADC_num, freq);
+
+    // enable pretrigger 0 (SC1A) and 1 (SC1B)
+    PDB0_CHnC1 = PDB_CHnC1_TOS_1 | PDB_CHnC1_EN_1 | PDB_CHnC1_TOS_2 | PDB_CHnC1_EN_2 | (delayB ? 0 : PDB_CHnC1_BB_2);
+
+    return true;
+}
+
+#ifdef ADC_DUAL_ADCS
+bool ADC_Module::startSynchronizedPDB(uint32_t freq, ADC_Module *adc_other) {
+    uint32_t mod;
+    uint8_t prescaler, mult;
+    if(!getPDBSettings(freq, mod, prescaler, mult)) {
+        fail_flag |= ADC_ERROR::OTHER;
+        return false;
+    }
+
+    if (!(SIM_SCGC6 & SIM_SCGC6_PDB)) { // setup PDB
+        SIM_SCGC6 |= SIM_SCGC6_PDB; // enable pdb clock
+    }
+
+    setHardwareTrigger(); // trigger both ADCs with hardware
+    adc_other->setHardwareTrigger();
+
+    PDB0_IDLY = 1; // the pdb interrupt happens when IDLY is equal to CNT+1
+
+    PDB0_MOD = (uint16_t)(mod-1);
+
+    // both conversions start at the beginning of the period
+    PDB0_CHnDLY0 = 0;
+    adc_other->PDB0_CHnDLY0 = 0;
+
+    PDB0_SC = ADC_PDB_CONFIG | PDB_SC_PRESCALER(prescaler) | PDB_SC_MULT(mult) | PDB_SC_LDOK; // load all new values
+
+    // enable pretrigger 0 of both ADCs before the counter starts, so none of them misses the first period
+    PDB0_CHnC1 = PDB_CHnC1_TOS_1 | PDB_CHnC1_EN_1;
+    adc_other->PDB0_CHnC1 = PDB_CHnC1_TOS_1 | PDB_CHnC1_EN_1;
+
+    PDB0_SC = ADC_PDB_CONFIG | PDB_SC_PRESCALER(prescaler) | PDB_SC_MULT(mult) | PDB_SC_SWTRIG; // start the counter!
+
+    ADC_TRACE_EVENT(TIMER_START, ADC_num, freq);
+
+    return true;
+}
+#endif
+
 void ADC_Module::stopPDB() {
     if (!(SIM_SCGC6 & SIM_SCGC6_PDB)) { // if PDB clock wasn't on, return
         setSoftwareTrigger();
         return;
     }
     PDB0_SC = 0;
+    PDB0_CHnC1 = 0; // disable the pretriggers
+    ADC_TRACE_EVENT(TIMER_STOP, ADC_num, 0);
+    // startPDBPingPong moved the interrupt to SC1B, give it back to SC1A.
+    // With the hardware trigger still set, writing SC1A doesn't start a conversion.
+    ADC_DISABLE_IRQ();
+    if (atomic::getBitFlag(adc_regs.SC1B, ADC_SC1_AIEN)) {
+        adc_regs.SC1A |= ADC_SC1_AIEN;
+    }
+    adc_regs.SC1B = ADC_SC1A_PIN_INVALID; // in case startPDBPingPong used it
+    ADC_ENABLE_IRQ();
     setSoftwareTrigger();
 
     //NVIC_DISABLE_IRQ(IRQ_PDB);
@@ -1492,16 +2563,109 @@ extern "C" {
 }
 
 void ADC_Module::startQuadTimer(uint32_t freq) {
-    // First lets setup the XBAR
-    CCM_CCGR2 |= CCM_CCGR2_XBAR1(CCM_CCGR_ON);   //turn clock on for xbara1
-    xbar_connect(XBAR_IN, XBAR_OUT);
-
     // Update the ADC
     uint8_t adc_pin_channel = adc_regs.HC0 & 0x1f; // remember the trigger that was set
     setHardwareTrigger();   // set the hardware trigger
     adc_regs.HC0 = (adc_regs.HC0 & ~0x1f) | 16;      // ADC_ETC channel remember other states...
     singleMode();           // make sure continuous is turned off as you want the trigger to di it. 
 
+    startQuadTimerTrigger(&adc_pin_channel, 1, freq);
+}
+
+bool ADC_Module::startQuadTimerChain(const uint8_t *pins, uint8_t num_pins, uint32_t freq) {
+    if((num_pins == 0) || (num_pins > ADC_ETC_MAX_CHAIN)) {
+        fail_flag |= ADC_ERROR::OTHER;
+        return false;
+    }
+
+    uint8_t adc_channels[ADC_ETC_MAX_CHAIN];
+    for(uint8_t i=0; i<num_pins; i++) {
+        if(!checkPin(pins[i])) {
+            fail_flag |= ADC_ERROR::WRONG_PIN;
+            return false;
+        }
+        adc_channels[i] = channel2sc1a[pins[i]] & ADC_SC1A_CHANNELS;
+    }
+
+    setHardwareTrigger();
+    singleMode();
+
+    // Segment i of the chain converts with HCi, all of them take the channel from the ADC_ETC.
+    // Only the last one raises the ADC interrupt (if enabled), once the whole chain is done.
+    volatile uint32_t *hc = &adc_regs.HC0;
+    for(uint8_t i=0; i<num_pins; i++) {
+        hc[i] = ((interrupts_enabled && (i == num_pins-1)) ? ADC_HC_AIEN : 0) | 16;
+    }
+
+    startQuadTimerTrigger(adc_channels, num_pins, freq);
+
+    return true;
+}
+
+#ifdef ADC_DUAL_ADCS
+bool ADC_Module::startSynchronizedQuadTimer(uint32_t freq, ADC_Module *adc_other) {
+    // TRIG0 drives TRIG4 in sync mode, not the other way around
+    if((ADC_num != 0) || (freq == 0)) {
+        fail_flag |= ADC_ERROR::OTHER;
+        return false;
+    }
+
+    // both ADCs take the channel from the ADC_ETC, remember the pins that were set
+    uint8_t adc_pin_channel = adc_regs.HC0 & 0x1f;
+    uint8_t other_pin_channel = adc_other->adc_regs.HC0 & 0x1f;
+    setHardwareTrigger();
+    adc_regs.HC0 = (adc_regs.HC0 & ~0x1f) | 16;
+    singleMode();
+    adc_other->setHardwareTrigger();
+    adc_other->adc_regs.HC0 = (adc_other->adc_regs.HC0 & ~0x1f) | 16;
+    adc_other->singleMode();
+
+    // The chain of the other ADC is started by our trigger, program it before the timer runs
+    // so the first tick already converts in both.
+    const uint8_t other_index = adc_other->ADC_ETC_TRIGGER_INDEX;
+    IMXRT_ADC_ETC.TRIG[other_index].CTRL = ADC_ETC_TRIG_CTRL_TRIG_CHAIN(0);
+    IMXRT_ADC_ETC.TRIG[other_index].CHAIN_1_0 = ADC_ETC_TRIG_CHAIN_HWTS0(1) | ADC_ETC_TRIG_CHAIN_CSEL0(other_pin_channel)
+                                               | ADC_ETC_TRIG_CHAIN_IE0(1);
+    adc_other->etc_chain_length = 1;
+    if (adc_other->adc_regs.GC & ADC_GC_DMAEN) {
+        IMXRT_ADC_ETC.DMA_CTRL |= ADC_ETC_DMA_CTRL_TRIQ_ENABLE(other_index);
+    }
+
+    startQuadTimerTrigger(&adc_pin_channel, 1, freq, ADC_ETC_TRIG_CTRL_SYNC_MODE);
+
+    return true;
+}
+#endif
+
+int ADC_Module::readQuadTimerChain(uint8_t index) {
+    if(index >= etc_chain_length) {
+        return ADC_ERROR_VALUE;
+    }
+    // the result registers R0-R7 follow each other, reading one clears its COCO flag.
+    return (&adc_regs.R0)[index];
+}
+
+void ADC_Module::startQuadTimerTrigger(const uint8_t *adc_channels, uint8_t num_channels, uint32_t freq, uint32_t trig_ctrl) {
+    // First lets setup the XBAR
+    CCM_CCGR2 |= CCM_CCGR2_XBAR1(CCM_CCGR_ON);   //turn clock on for xbara1
+    xbar_connect(XBAR_IN, XBAR_OUT);
+
+    // Chain segments come in pairs, segment i converts adc_channels[i] with HCi.
+    // Every segment but the last one starts the next one as soon as it's done (B2B).
+    // The last one raises the DONE0 interrupt/DMA request of the ADC_ETC.
+    uint32_t chain[ADC_ETC_MAX_CHAIN/2] = {0};
+    for(uint8_t i=0; i<num_channels; i++) {
+        const bool last = (i == num_channels-1);
+        if(i & 1) {
+            chain[i/2] |= ADC_ETC_TRIG_CHAIN_HWTS1(1 << i) | ADC_ETC_TRIG_CHAIN_CSEL1(adc_channels[i])
+                        | (last ? ADC_ETC_TRIG_CHAIN_IE1(1) : ADC_ETC_TRIG_CHAIN_B2B1);
+        } else {
+            chain[i/2] |= ADC_ETC_TRIG_CHAIN_HWTS0(1 << i) | ADC_ETC_TRIG_CHAIN_CSEL0(adc_channels[i])
+                        | (last ? ADC_ETC_TRIG_CHAIN_IE0(1) : ADC_ETC_TRIG_CHAIN_B2B0);
+        }
+    }
+    etc_chain_length = num_channels;
+
     // setup adc_etc - BUGBUG have not used the preset values yet. 
     if ( IMXRT_ADC_ETC.CTRL & ADC_ETC_CTRL_SOFTRST) {// SOFTRST
         // Soft reset 
@@ -1511,30 +2675,23 @@ void ADC_Module::startQuadTimer(uint32_t freq) {
     if (ADC_num == 0) { // BUGBUG - in real code, should probably know we init ADC or not..
         IMXRT_ADC_ETC.CTRL |= 
             (ADC_ETC_CTRL_TSC_BYPASS | ADC_ETC_CTRL_DMA_MODE_SEL | ADC_ETC_CTRL_TRIG_ENABLE(1 << ADC_ETC_TRIGGER_INDEX)); // 0x40000001;  // start with trigger 0
-        IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CTRL = ADC_ETC_TRIG_CTRL_TRIG_CHAIN(0);   // chainlength -1 only us
-        IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CHAIN_1_0 =
-            ADC_ETC_TRIG_CHAIN_IE0(1) /*| ADC_ETC_TRIG_CHAIN_B2B0 */
-            | ADC_ETC_TRIG_CHAIN_HWTS0(1) | ADC_ETC_TRIG_CHAIN_CSEL0(adc_pin_channel) ;
-
-        if (interrupts_enabled) {
-            // Not sure yet? 
-        }
-        if (adc_regs.GC & ADC_GC_DMAEN) {
-            IMXRT_ADC_ETC.DMA_CTRL |= ADC_ETC_DMA_CTRL_TRIQ_ENABLE(ADC_ETC_TRIGGER_INDEX);
-        }
     } else {
         // This is our second one... Try second trigger? 
         // Remove the BYPASS?
         IMXRT_ADC_ETC.CTRL &= ~(ADC_ETC_CTRL_TSC_BYPASS); // 0x40000001;  // start with trigger 0
         IMXRT_ADC_ETC.CTRL |= ADC_ETC_CTRL_DMA_MODE_SEL | ADC_ETC_CTRL_TRIG_ENABLE(1 << ADC_ETC_TRIGGER_INDEX);     // Add trigger 
-        IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CTRL = ADC_ETC_TRIG_CTRL_TRIG_CHAIN(0);   // chainlength -1 only us
-        IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CHAIN_1_0 =
-          ADC_ETC_TRIG_CHAIN_IE0(1) /*| ADC_ETC_TRIG_CHAIN_B2B0 */
-          | ADC_ETC_TRIG_CHAIN_HWTS0(1) | ADC_ETC_TRIG_CHAIN_CSEL0(adc_pin_channel) ;
-
-        if (adc_regs.GC & ADC_GC_DMAEN) {
-            IMXRT_ADC_ETC.DMA_CTRL |= ADC_ETC_DMA_CTRL_TRIQ_ENABLE(ADC_ETC_TRIGGER_INDEX);
-        }
+    }
+    IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CTRL = ADC_ETC_TRIG_CTRL_TRIG_CHAIN(num_channels-1) | trig_ctrl;   // chainlength -1
+    IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CHAIN_1_0 = chain[0];
+    IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CHAIN_3_2 = chain[1];
+    IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CHAIN_5_4 = chain[2];
+    IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CHAIN_7_6 = chain[3];
+
+    if (interrupts_enabled) {
+        // Not sure yet? 
+    }
+    if (adc_regs.GC & ADC_GC_DMAEN) {
+        IMXRT_ADC_ETC.DMA_CTRL |= ADC_ETC_DMA_CTRL_TRIQ_ENABLE(ADC_ETC_TRIGGER_INDEX);
     }
 
     // Now init the QTimer.
@@ -1553,12 +2710,15 @@ void ADC_Module::startQuadTimer(uint32_t freq) {
 
     quadtimerFrequency(&IMXRT_TMR4, QTIMER4_INDEX, freq);
     quadtimerWrite(&IMXRT_TMR4, QTIMER4_INDEX, 5);
+    ADC_TRACE_EVENT(TIMER_START, ADC_num, freq);
 
 }
 
 //! Stop the PDB
 void ADC_Module::stopQuadTimer() {
+    ADC_TRACE_EVENT(TIMER_STOP, ADC_num, 0);
     quadtimerWrite(&IMXRT_TMR4, QTIMER4_INDEX, 0);  
+    atomic::clearBitFlag(IMXRT_ADC_ETC.TRIG[ADC_ETC_TRIGGER_INDEX].CTRL, ADC_ETC_TRIG_CTRL_SYNC_MODE); // in case startSynchronizedQuadTimer set it
     setSoftwareTrigger();
 }
 
@@ -39,6 +39,12 @@ See the ADC_Module class for all methods.
 #include <Arduino.h>
 #include <settings_defines.h>
 #include <atomic.h>
+#include <ADC_IRQStats.h>
+#include <ADC_Trace.h>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
 
 using ADC_Error::ADC_ERROR;
 using namespace ADC_settings;
@@ -47,6 +53,19 @@ using namespace ADC_settings;
 // debug mode: blink the led light
 #define ADC_debug 0
 
+// max number of conversions in the queue of each ADC, see submit
+#ifndef ADC_QUEUE_SIZE
+#define ADC_QUEUE_SIZE 8
+#endif
+
+// getExpectedWait() of an ADC that is streaming, it shouldn't be used for other conversions
+#define ADC_WAIT_STREAMING (0xFFFFFFFF)
+
+// number of calibration results kept by each module, see clearCalibrationCache. 0 disables the cache.
+#ifndef ADC_CALIB_CACHE_SIZE
+#define ADC_CALIB_CACHE_SIZE 4
+#endif
+
 
 /** Class ADC_Module: Implements all functions of the Teensy 3.x, LC analog to digital converter
 *
@@ -74,24 +93,45 @@ public:
     *   \param a_channel2sc1a contains an index that pairs each pin to its SC1A number (used to start a conversion on that pin)
     *   \param a_diff_table is similar to a_channel2sc1a, but for differential pins.
     *   \param a_adc_regs pointer to start of the ADC registers
+    *   \param init initialize the module and start the calibration now, otherwise call begin() later.
     */
     ADC_Module(uint8_t ADC_number, 
                const uint8_t* const a_channel2sc1a, 
                const ADC_NLIST* const a_diff_table,
-               ADC_REGS_t &a_adc_regs);
+               ADC_REGS_t &a_adc_regs,
+               bool init = true);
     #else
     //! Constructor
     /** Pass the ADC number and the Channel number to SC1A number arrays.
     *   \param ADC_number Number of the ADC module, from 0.
     *   \param a_channel2sc1a contains an index that pairs each pin to its SC1A number (used to start a conversion on that pin)
     *   \param a_adc_regs pointer to start of the ADC registers
+    *   \param init initialize the module and start the calibration now, otherwise call begin() later.
     */
     ADC_Module(uint8_t ADC_number, 
                const uint8_t* const a_channel2sc1a, 
-               ADC_REGS_t &a_adc_regs);
+               ADC_REGS_t &a_adc_regs,
+               bool init = true);
     #endif
 
 
+    //! Initialize the module and start the calibration, without waiting for it
+    /** The constructor calls it unless it was told not to. Don't use any other function before.
+    *   The module is ready after two calibrations (32 averages at low speed and then at medium speed),
+    *   poll isReady() or just use it, any function that needs the calibration waits for it.
+    *   Calling it again resets all settings to the default values.
+    */
+    void begin() {
+        analog_init();
+    }
+
+    //! Is the module initialized and calibrated?
+    /** It never waits, but when a calibration has finished it writes the registers and, at startup,
+    *   starts the next one.
+    *   \return true if the module can be used without waiting for a calibration.
+    */
+    bool isReady();
+
     //! Starts the calibration sequence, waits until it's done and writes the results
     /** Usually it's not necessary to call this function directly, but do it if the "environment" changed
     *   significantly since the program was started.
@@ -102,8 +142,65 @@ public:
     void calibrate();
 
     //! Waits until calibration is finished and writes the corresponding registers
+    /** It returns at once if the ADC isn't calibrating.
+    */
     void wait_for_cal();
 
+    //! Forget all the calibration results stored in the cache
+    /** The module keeps the results of the last ADC_CALIB_CACHE_SIZE calibrations, one per conversion speed
+    *   and reference (setConversionSpeed() and setReference() calibrate, the resolution and averaging don't).
+    *   When calibrate() is called for a pair that is already in the cache the registers are restored at once
+    *   instead of calibrating again.
+    *   recalibrate() clears the cache, call it if the temperature or the supply changed significantly.
+    */
+    void clearCalibrationCache();
+
+    //! Save the calibration cache to the EEPROM
+    /** It stores all the calibration results of the cache (see clearCalibrationCache()) with a fingerprint
+    *   of the board, the clocks and the module, so that loadCalibration() can restore them after a reset.
+    *   Call it after calibrating all the conversion speeds and references you'll use (set them once), it uses calibrationEEPROMSize() bytes.
+    *   \param address first byte of the EEPROM to use.
+    *   \return true if there was something to save.
+    */
+    bool saveCalibration(int address);
+
+    //! Load the calibration cache from the EEPROM
+    /** If the data was saved by saveCalibration() for this board, clocks and module, it stops the calibration that
+    *   is taking place (the one started at startup, for example), fills the cache and restores the calibration
+    *   of the current conversion speed and reference without waiting. Those that were not saved are calibrated as usual.
+    *   If it stops the startup calibration it also sets the default speeds (medium) and averages (4).
+    *   If the data isn't valid nothing changes and the normal calibration continues.
+    *   Use startCalibrationCheck() once in a while to detect if the saved results are too old.
+    *   \param address first byte of the EEPROM used by saveCalibration().
+    *   \return true if the data was valid and loaded.
+    */
+    bool loadCalibration(int address);
+
+    //! Number of bytes of the EEPROM used by saveCalibration()
+    static constexpr int calibrationEEPROMSize() {
+        #if ADC_CALIB_CACHE_SIZE > 0
+        return sizeof(CalibrationRecord);
+        #else
+        return 0;
+        #endif
+    }
+
+    //! Start a new calibration of the current conversion speed and reference and compare it with the cached one
+    /** It doesn't wait for the calibration to finish, like calibrate(). When it's done, if the new values are too
+    *   different from the old ones (loaded from the EEPROM, for example) the rest of the cache is cleared,
+    *   so all other speeds and references will be calibrated again, and calibrationDrifted() returns true.
+    *   The new calibration is used in any case.
+    *   \param max_difference maximum difference allowed in any of the calibration registers.
+    *   \return false if there was no calibration of this speed and reference in the cache, nothing is checked then.
+    */
+    bool startCalibrationCheck(uint16_t max_difference = 4);
+
+    //! Result of the last startCalibrationCheck()
+    /** It waits for the calibration to finish if needed.
+    *   \return true if the calibration changed more than allowed since it was cached.
+    */
+    bool calibrationDrifted();
+
 
     /////////////// METHODS TO SET/GET SETTINGS OF THE ADC ////////////////////
 
@@ -184,6 +281,40 @@ public:
     void setAveraging(uint8_t num);
 
 
+    //! Conversion speed, sampling speed, averaging and resolution, ready to be written to the registers at once
+    /** Get one with captureProfile() after setting everything once with the normal functions, then switch
+    *   between profiles with applyProfile(), that only writes the final value of each register.
+    *   The reference isn't part of the profile.
+    */
+    struct Profile {
+        //! \cond internal
+        #ifdef ADC_TEENSY_4
+        uint32_t cfg, gc; // values of the bits in PROFILE_CFG_MASK and PROFILE_GC_MASK
+        #else
+        uint32_t cfg1, cfg2, sc3; // values of the bits in PROFILE_CFG1_MASK, PROFILE_CFG2_MASK and PROFILE_SC3_MASK
+        #endif
+        ADC_CONVERSION_SPEED conversion_speed;
+        ADC_SAMPLING_SPEED sampling_speed;
+        uint8_t res_bits;
+        uint32_t max_val;
+        uint8_t num_average;
+        //! \endcond
+    };
+
+    //! Store the current conversion speed, sampling speed, averaging and resolution in a Profile
+    /** It waits for the calibration to finish, if needed.
+    *   \return the profile, use it with applyProfile().
+    */
+    Profile captureProfile();
+
+    //! Change the conversion speed, sampling speed, averaging and resolution to those of the profile
+    /** Each register is written once with interrupts disabled, instead of one read-modify-write per bit field.
+    *   It recalibrates only if the conversion speed changes, and the calibration cache usually makes it immediate.
+    *   \param profile a profile from captureProfile(), of this or the other ADC.
+    */
+    void applyProfile(const Profile &profile);
+
+
     //! Enable interrupts
     /** An IRQ_ADCx Interrupt will be raised when the conversion is completed
     *  (including hardware averages and if the comparison (if any) is true).
@@ -362,6 +493,76 @@ public:
         #endif
     }
 
+    //! Is the ADC started by hardware (PDB or timers)?
+    /**
+    *   \return true or false
+    */
+    volatile bool isHardwareTriggered() __attribute__((always_inline)) {
+        #ifdef ADC_TEENSY_4
+        return atomic::getBitFlag(adc_regs.CFG, ADC_CFG_ADTRG);
+        #else
+        return atomic::getBitFlag(adc_regs.SC2, ADC_SC2_ADTRG);
+        #endif
+    }
+
+    //! Does the ADC request a DMA transfer for each result?
+    /**
+    *   \return true or false
+    */
+    volatile bool isDMAEnabled() __attribute__((always_inline)) {
+        #ifdef ADC_TEENSY_4
+        return atomic::getBitFlag(adc_regs.GC, ADC_GC_DMAEN);
+        #else
+        return atomic::getBitFlag(adc_regs.SC2, ADC_SC2_DMAEN);
+        #endif
+    }
+
+    //! Is the ADC busy with a stream of conversions?
+    /** Continuous mode, hardware trigger or DMA: a conversion started by another function would interrupt it.
+    *   \return true or false
+    */
+    bool isStreaming() {
+        return isContinuous() || isHardwareTriggered() || isDMAEnabled();
+    }
+
+    //! Set the priority of the stream of conversions running in this ADC
+    /** A read (analogRead(), startSingleRead()...) with a higher priority interrupts the stream:
+    *   the conversion in progress is aborted, the trigger, DMA, continuous mode and comparison are disabled
+    *   during the read and the whole state is restored after it.
+    *   The read starts at once, so it takes getConversionTime() plus a few register writes. The stream loses the
+    *   conversion it was doing and the hardware triggers that arrive during the read.
+    *   Reads with the same or lower priority fail with ADC_ERROR::PREEMPT.
+    *   \param priority of the stream, BACKGROUND by default (any read interrupts it).
+    */
+    void setStreamPriority(ADC_PRIORITY priority) {
+        stream_priority = priority;
+    }
+
+    //! Priority of the stream of conversions, see setStreamPriority()
+    ADC_PRIORITY getStreamPriority() {
+        return stream_priority;
+    }
+
+    //! Can a read with this priority use the ADC now?
+    /** \param priority of the read.
+    *   \return true if no stream is running or its priority is lower.
+    */
+    bool canPreempt(ADC_PRIORITY priority) {
+        return !isStreaming() || (priority > stream_priority);
+    }
+
+    //! Estimated duration of one conversion with the current settings
+    /** Computed from the ADC clock, resolution, sampling time and number of averages.
+    *   \return the time in CPU cycles.
+    */
+    uint32_t getConversionTime();
+
+    //! Estimated time until the result of a conversion started now would be ready
+    /** It includes the calibration (if it's taking place) and the conversion in progress, if any.
+    *   \return the time in CPU cycles, or ADC_WAIT_STREAMING if the ADC isStreaming().
+    */
+    uint32_t getExpectedWait();
+
     #ifdef ADC_USE_PGA
     //! Is the PGA function enabled?
     /**
@@ -397,8 +598,9 @@ public:
     /** It sets the mux correctly, doesn't do any of the checks on the pin and
     *   doesn't change the continuous conversion bit.
     *   \param pin to read.
+    *   \param interrupt raise the ADC interrupt even if enableInterrupts() wasn't called (startRead() uses it).
     */
-    void startReadFast(uint8_t pin); // helper method
+    void startReadFast(uint8_t pin, bool interrupt = false); // helper method
 
     #if ADC_DIFF_PAIRS > 0
     //! Starts a differential conversion on the pair of pins
@@ -416,11 +618,13 @@ public:
     //! Returns the analog value of the pin.
     /** It waits until the value is read and then returns the result.
     * If a comparison has been set up and fails, it will return ADC_ERROR_VALUE.
-    * This function is interrupt safe, so it will restore the adc to the state it was before being called
+    * This function is interrupt safe, so it will restore the adc to the state it was before being called,
+    * including a stream of conversions it interrupts (see setStreamPriority()).
     *   \param pin pin to read.
+    *   \param priority the read fails (ADC_ERROR::PREEMPT) if a stream with the same or higher priority is running.
     *   \return the value of the pin.
     */
-    int analogRead(uint8_t pin);
+    int analogRead(uint8_t pin, ADC_PRIORITY priority = ADC_PRIORITY::NORMAL);
 
     //! Returns the analog value of the special internal source, such as the temperature sensor.
     /** It calls analogRead(uint8_t pin) internally, with the correct value for the pin for all boards.
@@ -438,16 +642,124 @@ public:
     }
 
 
+
+    //////////////// PREPARED CHANNELS //////////////////
+
+    //! Starts a conversion of sc1a_pin (a value of channel2sc1a) without any checks
+    /** It selects the mux (Teensy 3.x) and writes the channel, the conversion doesn't raise the ADC interrupt.
+    *   Pending AsyncRead handles of the ADC fail, like with any other conversion.
+    *   \param regs registers of the ADC.
+    *   \param sc1a_pin value of channel2sc1a for the pin.
+    *   \param adc_num number of the ADC of regs.
+    */
+    static void startFast(ADC_REGS_t &regs, uint8_t sc1a_pin, uint8_t adc_num) __attribute__((always_inline)) {
+        #ifdef ADC_TEENSY_4
+        regs.HC0 = sc1a_pin&ADC_SC1A_CHANNELS;
+        #else
+        if(sc1a_pin&ADC_SC1A_PIN_MUX) { // mux a
+            atomic::clearBitFlag(regs.CFG2, ADC_CFG2_MUXSEL);
+        } else { // mux b
+            atomic::setBitFlag(regs.CFG2, ADC_CFG2_MUXSEL);
+        }
+        regs.SC1A = sc1a_pin&ADC_SC1A_CHANNELS;
+        #endif
+        conversion_id[adc_num]++;
+    }
+
+    //! Waits for the conversion started with startFast() and returns the result
+    /** \param regs registers of the ADC.
+    *   \return the converted value, or ADC_ERROR_VALUE if a comparison fails.
+    */
+    static int waitFast(ADC_REGS_t &regs) __attribute__((always_inline)) {
+        #ifdef ADC_TEENSY_4
+        while(atomic::getBitFlag(regs.GS, ADC_GS_ADACT)) ;
+        if(!atomic::getBitFlag(regs.HS, ADC_HS_COCO0)) {
+            return ADC_ERROR_VALUE;
+        }
+        return (uint16_t)regs.R0;
+        #else
+        while(atomic::getBitFlag(regs.SC2, ADC_SC2_ADACT)) ;
+        if(!atomic::getBitFlag(regs.SC1A, ADC_SC1_COCO)) {
+            return ADC_ERROR_VALUE;
+        }
+        return (uint16_t)regs.RA;
+        #endif
+    }
+
+    //! Converts sc1a_pin (a value of channel2sc1a) and returns the result
+    /** It only selects the mux (Teensy 3.x), starts the conversion and waits for the result:
+    *   it doesn't check the pin, save or restore the ADC state, or disable interrupts.
+    *   Used by PreparedChannel::read() and ADC::analogRead<pin>(), see PreparedChannel.
+    *   \param regs registers of the ADC.
+    *   \param sc1a_pin value of channel2sc1a for the pin.
+    *   \param adc_num number of the ADC of regs.
+    *   \return the value of the pin, or ADC_ERROR_VALUE if a comparison fails.
+    */
+    static int readFast(ADC_REGS_t &regs, uint8_t sc1a_pin, uint8_t adc_num) __attribute__((always_inline)) {
+        startFast(regs, sc1a_pin, adc_num);
+        return waitFast(regs);
+    }
+
+    //! A pin checked and translated once, to read it many times with little overhead
+    /** Get one with prepareChannel(pin). read() only selects the mux (Teensy 3.x), starts the conversion and
+    *   waits for the result: it doesn't check the pin, save or restore the ADC state, or disable interrupts.
+    *   The ADC must be idle, in single mode and with the software trigger (the default state), and it doesn't
+    *   raise the ADC interrupt.
+    */
+    struct PreparedChannel {
+        //! Reads the pin
+        /** \return the value of the pin, or ADC_ERROR_VALUE if the pin isn't valid or a comparison fails.
+        */
+        int read() __attribute__((always_inline)) {
+            if(!regs) {
+                return ADC_ERROR_VALUE;
+            }
+            return readFast(*regs, sc1a_pin, adc_num);
+        }
+
+        //! Is the pin valid for the ADC?
+        bool isValid() const {
+            return regs != nullptr;
+        }
+
+        ADC_REGS_t *regs; //!< registers of the ADC, nullptr if the pin isn't valid
+        uint8_t sc1a_pin; //!< value of channel2sc1a for the pin
+        uint8_t adc_num; //!< number of the ADC
+    };
+
+    //! Prepares a pin to be read with PreparedChannel::read()
+    /** It checks the pin and waits for the calibration to finish, if needed.
+    *   \param pin pin to read.
+    *   \return the prepared channel, check it with isValid() (fail_flag is set if the pin isn't valid).
+    */
+    PreparedChannel prepareChannel(uint8_t pin);
+
+
+    //! Reads several pins, one after the other
+    /** Each conversion is started as soon as the previous result is read, and the next pin is looked up
+    *   while the current one converts, so it's faster than calling analogRead() for each pin.
+    *   If a comparison has been set up and fails for a pin, its result is ADC_ERROR_VALUE.
+    *   This function is interrupt safe, so it will restore the adc to the state it was before being called,
+    *   but the conversions don't raise the ADC interrupt.
+    *   \param pins array with the pins to read, all of them must be valid for this ADC.
+    *   \param results array of num_pins values, results[i] is the value of pins[i].
+    *   \param num_pins number of pins.
+    *   \return true if all pins are valid, false otherwise (no pin is read and fail_flag is set).
+    */
+    bool analogReadBatch(const uint8_t *pins, int *results, uint8_t num_pins);
+
+
     #if ADC_DIFF_PAIRS > 0
     //! Reads the differential analog value of two pins (pinP - pinN).
     /** It waits until the value is read and then returns the result.
     *   If a comparison has been set up and fails, it will return ADC_ERROR_DIFF_VALUE.
     *   \param pinP must be A10 or A12.
     *   \param pinN must be A11 (if pinP=A10) or A13 (if pinP=A12).
+    *   \param priority the read fails (ADC_ERROR::PREEMPT) if a stream with the same or higher priority is running.
     *   \return the difference between the pins if they are valid, othewise returns ADC_ERROR_DIFF_VALUE.
     *   This function is interrupt safe, so it will restore the adc to the state it was before being called
     */
-    int analogReadDifferential(uint8_t pinP, uint8_t pinN);
+    int analogReadDifferential(uint8_t pinP, uint8_t pinN, ADC_PRIORITY priority = ADC_PRIORITY::NORMAL);
     #endif
 
 
@@ -456,30 +768,146 @@ public:
     //! Starts an analog measurement on the pin and enables interrupts.
     /** It returns immediately, get value with readSingle().
     *   If this function interrupts a measurement, it stores the settings in adc_config
+    *   and readSingle() restores them.
+    *   If DMA is enabled and the ADC is idle (no conversion, continuous mode or hardware trigger) it doesn't
+    *   suspend anything: the conversion starts the DMA stream, call it before startTimer() or startPDB().
     *   \param pin pin to read.
+    *   \param priority it fails (ADC_ERROR::PREEMPT) if a stream with the same or higher priority is running.
     *   \return true if the pin is valid, false otherwise.
     */
-    bool startSingleRead(uint8_t pin);
+    bool startSingleRead(uint8_t pin, ADC_PRIORITY priority = ADC_PRIORITY::NORMAL);
 
     #if ADC_DIFF_PAIRS > 0
     //! Start a differential conversion between two pins (pinP - pinN) and enables interrupts.
     /** It returns immediately, get value with readSingle().
     *   If this function interrupts a measurement, it stores the settings in adc_config
+    *   and readSingle() restores them. Like startSingleRead(), it starts an idle DMA stream without suspending it.
     *   \param pinP must be A10 or A12.
     *   \param pinN must be A11 (if pinP=A10) or A13 (if pinP=A12).
+    *   \param priority it fails (ADC_ERROR::PREEMPT) if a stream with the same or higher priority is running.
     *   \return true if the pins are valid, false otherwise.
     */
-    bool startSingleDifferential(uint8_t pinP, uint8_t pinN);
+    bool startSingleDifferential(uint8_t pinP, uint8_t pinN, ADC_PRIORITY priority = ADC_PRIORITY::NORMAL);
     #endif
 
     //! Reads the analog value of a single conversion.
     /** Set the conversion with with startSingleRead(pin) or startSingleDifferential(pinP, pinN).
+    *   If that conversion interrupted another one or a stream, it's restarted.
     *   \return the converted value.
     */
     int readSingle() __attribute__((always_inline)) {
-        return analogReadContinuous();
+        const int result = analogReadContinuous();
+        ADC_TRACE_EVENT(CONVERSION_COMPLETE, ADC_num, result);
+        if (adcWasInUse) {
+            loadConfig(&adc_config);
+            adcWasInUse = 0;
+            ADC_TRACE_EVENT(RESUME, ADC_num, 0);
+        }
+        return result;
     }
 
+    //! Handle of a conversion started with startRead(), to poll it instead of waiting
+    /** Only one conversion can take place in an ADC: if another startRead() starts before this one is read,
+    *   or another conversion (analogRead(), a queued conversion...) replaces it and doesn't restart it,
+    *   the handle fails with ADC_ERROR_VALUE.
+    *   With C++20 coroutines it can be awaited: `int value = co_await adc->adc0->startRead(pin);`.
+    *   If startRead() could use the ADC interrupt, the coroutine is resumed from it (so it runs in the interrupt)
+    *   when the conversion is complete.
+    *   Otherwise (enableInterrupts() was called, or the queue, DMA or a comparison is used) co_await waits for the
+    *   result like get(). A coroutine waiting for a conversion that a stream (continuous mode, a timer...) replaces
+    *   isn't resumed.
+    */
+    class AsyncRead {
+    public:
+        //! Is the result available? It never waits
+        /** \return true if the conversion finished, failed or was cancelled: get() won't wait.
+        */
+        bool ready();
+
+        //! Returns the result, waiting for it if needed
+        /** \return the value of the pin, or ADC_ERROR_VALUE if the pin isn't valid, a comparison failed, another
+        *   conversion replaced this one or it was cancelled.
+        */
+        int get();
+
+        //! Stops the conversion, if it hasn't finished. get() will return ADC_ERROR_VALUE
+        void cancel();
+
+        //! Was the conversion started? False if the pin isn't valid
+        bool isValid() const {
+            return adc != nullptr;
+        }
+
+        #if defined(__cpp_impl_coroutine)
+        //! \cond internal
+        bool await_ready() {
+            return ready();
+        }
+        bool await_suspend(std::coroutine_handle<> coroutine);
+        int await_resume() {
+            return get();
+        }
+        //! \endcond
+        #endif
+
+    private:
+        friend class ADC_Module;
+
+        enum class State : uint8_t {PENDING, DONE};
+
+        ADC_Module *adc = nullptr;
+        uint8_t pin = 0;
+        uint16_t id = 0; // conversion_id of the ADC when the conversion started
+        bool interrupt = false; // the ADC interrupt reads the result, see asyncISR
+        State state = State::DONE;
+        int value = ADC_ERROR_VALUE;
+    };
+
+    //! Starts a single-ended conversion and returns a handle to poll it
+    /** Like startSingleRead(), it returns immediately. If it interrupts a conversion,
+    *   its settings are restored when the result is read (or by the interrupt, see below).
+    *   If enableInterrupts() wasn't called and the queue, DMA and comparisons aren't used, the conversion raises
+    *   the ADC interrupt, which reads the result (and resumes a coroutine that awaits it).
+    *   \param pin pin to read.
+    *   \return the handle, check it with isValid() (fail_flag is set if the pin isn't valid).
+    */
+    AsyncRead startRead(uint8_t pin);
+
+
+    ///////////// QUEUED CONVERSION METHODS ////////////
+
+    //! Function called with the result of a queued conversion, see submit()
+    /** \param value the converted value.
+    *   \param context the pointer given to submit().
+    */
+    typedef void (*ReadCallback)(int value, void *context);
+
+    //! Adds the conversion of a pin to the queue of this ADC and returns immediately
+    /** The conversions of the queue are done one after the other: when one is complete, the ADC interrupt
+    *   reads the result, starts the next one and then calls the callback of the first one, inside the interrupt.
+    *   The callback can submit() more conversions.
+    *   While there are conversions in the queue the queue uses the ADC interrupt, so don't use enableInterrupts(),
+    *   comparisons, continuous mode, hardware triggers, DMA or other conversion functions in this ADC.
+    *   If the queue is empty and the ADC is in use (a stream, a conversion started by startSingleRead() whose result
+    *   wasn't read, or enableInterrupts() was called) it fails with ADC_ERROR::PREEMPT instead of stopping it.
+    *   \param pin pin to read.
+    *   \param callback function called with the result.
+    *   \param context pointer passed to the callback, to tell the requests apart.
+    *   \return true if the pin is valid, the ADC was free or running the queue and there was space in the queue
+    *   (ADC_QUEUE_SIZE conversions).
+    */
+    bool submit(uint8_t pin, ReadCallback callback, void *context = nullptr);
+
+    //! Number of conversions in the queue, including the one that is converting
+    uint8_t getQueueLength() {
+        return queue_count;
+    }
+
+    //! Removes the conversions from the queue, their callbacks won't be called
+    /** The conversion taking place, if any, is stopped.
+    */
+    void clearQueue();
+
 
     ///////////// CONTINUOUS CONVERSION METHODS ////////////
 
@@ -542,6 +970,41 @@ public:
     */
     void startPDB(uint32_t freq);
 
+    //! Start PDB triggering two conversions per period, pinA with SC1A and pinB with SC1B
+    /** Pretrigger 0 converts pinA at the start of the period and pretrigger 1 converts pinB delayB/256 of the period later.
+    *   The ADC has to finish the first conversion before the second one starts, otherwise the second one is lost.
+    *   Read the values with readSingle() (pinA) and readSingleB() (pinB), or with DMA (see AnalogBufferDMA::initPingPong).
+    *   If interrupts are enabled, the interrupt is raised once per period after pinB is converted: read both values in the isr.
+    *   Call stopPDB() to stop.
+    *   \param pinA first pin to convert.
+    *   \param pinB second pin to convert, it can be the same as pinA to convert it at twice the frequency.
+    *          Both pins must use the same mux (a or b) of this ADC.
+    *   \param freq is the frequency of the pairs of conversions, it can't be lower that 1 Hz
+    *   \param delayB delay of the second conversion in 1/256 of the period (128 is half a period),
+    *          0 starts it as soon as the first conversion is done.
+    *   \return true if the PDB was started, false otherwise (fail_flag will be set).
+    */
+    bool startPDBPingPong(uint8_t pinA, uint8_t pinB, uint32_t freq, uint8_t delayB = 128);
+
+    #ifdef ADC_DUAL_ADCS
+    //! Start PDB triggering this ADC and adc_other at the same time
+    /** Both pretriggers are enabled before the counter starts, so every period, including the first one,
+    *   starts a conversion in both modules. Select the pins of both ADCs before calling this function,
+    *   or use ADC::startSynchronizedTimer(), which does both. Call stopPDB() on both modules to stop.
+    *   \param freq is the frequency of the pairs of conversions, it can't be lower that 1 Hz
+    *   \param adc_other the other ADC module.
+    *   \return true if the PDB was started, false otherwise (fail_flag will be set).
+    */
+    bool startSynchronizedPDB(uint32_t freq, ADC_Module *adc_other);
+    #endif
+
+    //! Reads the value of the second conversion of startPDBPingPong()
+    /** \return the converted value.
+    */
+    int readSingleB() __attribute__((always_inline)) {
+        return (int16_t)(int32_t)adc_regs.RB;
+    }
+
     //! Stop the default timer (PDB)
     void stopTimer() __attribute__((always_inline)) { stopPDB(); }
     //! Stop the PDB
@@ -590,6 +1053,36 @@ public:
     *   \return the timer's frequency in Hz.
     */
     uint32_t getQuadTimerFrequency();
+
+    //! Start a Quad timer that triggers a scan of several pins at the frequency
+    /** Each tick of the timer converts all pins, one after the other (back-to-back), using a trigger chain of the ADC_ETC.
+    *   The CPU isn't involved at all: read the results with readQuadTimerChain() or with DMA from the ADC_ETC result registers.
+    *   If interrupts are enabled, the interrupt is raised only after the last pin has been converted.
+    *   \param pins array with the pins to scan, all of them must be valid for this ADC.
+    *   \param num_pins number of pins in the array, from 1 to ADC_ETC_MAX_CHAIN (8).
+    *   \param freq is the frequency of the scan, it can't be lower that 1 Hz
+    *   \return true if the scan was started, false otherwise (fail_flag will be set).
+    */
+    bool startQuadTimerChain(const uint8_t *pins, uint8_t num_pins, uint32_t freq);
+
+    //! Return the last value converted for one pin of the scan
+    /** \param index position of the pin in the array given to startQuadTimerChain().
+    *   \return the value, or ADC_ERROR_VALUE if index is not part of the scan.
+    */
+    int readQuadTimerChain(uint8_t index);
+
+    #ifdef ADC_DUAL_ADCS
+    //! Start a Quad timer triggering this ADC and adc_other at the same time
+    /** The ADC_ETC runs the trigger of adc_other in sync mode with the one of this ADC, so every tick of the timer
+    *   starts a conversion in both modules. Only ADC0 can start it (its trigger drives the one of ADC1).
+    *   Select the pins of both ADCs before calling this function, or use ADC::startSynchronizedTimer(), which does both.
+    *   Call stopQuadTimer() on both modules to stop.
+    *   \param freq is the frequency of the pairs of conversions, it can't be lower that 1 Hz
+    *   \param adc_other the other ADC module.
+    *   \return true if the timer was started, false otherwise (fail_flag will be set).
+    */
+    bool startSynchronizedQuadTimer(uint32_t freq, ADC_Module *adc_other);
+    #endif
     #endif
 
 
@@ -597,12 +1090,14 @@ public:
     //////// OTHER STUFF ///////////
 
     //! Store the config of the adc
+    /** All the state of a stream: channel, trigger, DMA, continuous mode, averages and comparison.
+    */
     struct ADC_Config {
         //! ADC registers
         #ifdef ADC_TEENSY_4
-        uint32_t savedHC0, savedCFG, savedGC, savedGS;
+        uint32_t savedHC0, savedCFG, savedGC, savedGS, savedCV;
         #else
-        uint32_t savedSC1A, savedSC2, savedSC3, savedCFG1, savedCFG2;
+        uint32_t savedSC1A, savedSC2, savedSC3, savedCFG1, savedCFG2, savedCV1, savedCV2;
         #endif
     } adc_config;
 
@@ -618,12 +1113,15 @@ public:
         config->savedCFG = adc_regs.CFG;
         config->savedGC = adc_regs.GC;
         config->savedGS = adc_regs.GS;        
+        config->savedCV = adc_regs.CV;
         #else
         config->savedSC1A = adc_regs.SC1A;
         config->savedCFG1 = adc_regs.CFG1;
         config->savedCFG2 = adc_regs.CFG2;
         config->savedSC2 = adc_regs.SC2;
         config->savedSC3 = adc_regs.SC3;
+        config->savedCV1 = adc_regs.CV1;
+        config->savedCV2 = adc_regs.CV2;
         #endif
     }
 
@@ -632,11 +1130,14 @@ public:
     */
     void loadConfig(const ADC_Config* config) {
         #ifdef ADC_TEENSY_4
-        adc_regs.HC0 = config->savedHC0;
+        adc_regs.CV = config->savedCV;
         adc_regs.CFG = config->savedCFG;
         adc_regs.GC = config->savedGC;
         adc_regs.GS = config->savedGS;         
+        adc_regs.HC0 = config->savedHC0; // restore last
         #else
+        adc_regs.CV1 = config->savedCV1;
+        adc_regs.CV2 = config->savedCV2;
         adc_regs.CFG1 = config->savedCFG1;
         adc_regs.CFG2 = config->savedCFG2;
         adc_regs.SC2 = config->savedSC2;
@@ -670,10 +1171,180 @@ private:
     // is set to 1 when the calibration procedure is taking place
     uint8_t calibrating;
 
-    // the first calibration will use 32 averages and lowest speed,
-    // when this calibration is over the averages and speed will be set to default.
+    // the first calibration will use 32 averages and lowest speed (init_calib=2),
+    // when this calibration is over the speed will be set to default and it calibrates again (init_calib=1),
+    // after that the averages are set to default.
     uint8_t init_calib;
 
+    // bits of the registers that belong to a Profile
+    #ifdef ADC_TEENSY_4
+    static constexpr uint32_t PROFILE_CFG_MASK = ADC_CFG_ADICLK(3) | ADC_CFG_ADIV(3) | ADC_CFG_ADLPC | ADC_CFG_ADHSC
+                                                 | ADC_CFG_ADLSMP | ADC_CFG_ADSTS(3) | ADC_CFG_MODE(3) | ADC_CFG_AVGS(3);
+    static constexpr uint32_t PROFILE_GC_MASK = ADC_GC_ADACKEN | ADC_GC_AVGE;
+    #else
+    static constexpr uint32_t PROFILE_CFG1_MASK = ADC_CFG1_ADICLK(3) | ADC_CFG1_ADIV(3) | ADC_CFG1_ADLPC
+                                                  | ADC_CFG1_ADLSMP | ADC_CFG1_MODE(3);
+    static constexpr uint32_t PROFILE_CFG2_MASK = ADC_CFG2_ADACKEN | ADC_CFG2_ADHSC | ADC_CFG2_ADLSTS(3);
+    static constexpr uint32_t PROFILE_SC3_MASK = ADC_SC3_AVGE | ADC_SC3_AVGS(3);
+    #endif
+
+    // priority of the stream, see setStreamPriority
+    ADC_PRIORITY stream_priority;
+
+    // ADC::analogReadBatch suspends and resumes both modules
+    friend class ADC;
+
+    // DMA enabled but not converting, in continuous mode or hardware triggered: a stream being set up
+    bool isArmedStream() {
+        return isDMAEnabled() && !isContinuous() && !isHardwareTriggered() && !isConverting();
+    }
+
+    // saves the state of the ADC in config and stops the conversion or stream (if any), returns whether there was one
+    uint8_t suspendStream(ADC_Config *config);
+
+    // restores the state saved by suspendStream
+    void resumeStream(const ADC_Config *config) {
+        ADC_DISABLE_IRQ();
+        loadConfig(config);
+        ADC_TRACE_EVENT(RESUME, ADC_num, 0);
+        ADC_ENABLE_IRQ();
+    }
+
+    // incremented every time a conversion is started in each ADC, see AsyncRead.
+    // It's static so that startFast can increment it.
+    static volatile uint16_t conversion_id[ADC_NUM_ADCS];
+
+    // conversions waiting in the queue, see submit
+    struct QueuedRead {
+        uint8_t pin;
+        ReadCallback callback;
+        void *context;
+    };
+    QueuedRead read_queue[ADC_QUEUE_SIZE];
+    volatile uint8_t queue_head;
+    volatile uint8_t queue_count;
+
+    // starts the first conversion of the queue with interrupts
+    void startQueue();
+
+    // was enableInterrupts called? While the queue is empty the interrupt isn't the queue's
+    bool userInterruptsEnabled() {
+        #ifdef ADC_TEENSY_4
+        return atomic::getBitFlag(adc_regs.HC0, ADC_HC_AIEN) && !async_interrupt;
+        #else
+        return atomic::getBitFlag(adc_regs.SC1A, ADC_SC1_AIEN) && !async_interrupt;
+        #endif
+    }
+
+    // the conversion of the first element of the queue is complete
+    void queueISR();
+
+    // the interrupt of the conversion async_id started by startRead is enabled, it must not go to other conversions
+    volatile bool async_interrupt;
+    // conversion started by startRead with the interrupt, and its result once asyncISR has read it
+    volatile uint16_t async_id;
+    volatile bool async_done;
+    volatile int async_value;
+    #if defined(__cpp_impl_coroutine)
+    // coroutine waiting for async_id, resumed by asyncISR
+    void *async_coroutine;
+    #endif
+
+    // AIEN is only set for the conversion of startRead: is it still the one in the ADC?
+    bool isAsyncConversion() {
+        #ifdef ADC_TEENSY_4
+        return async_interrupt && atomic::getBitFlag(adc_regs.HC0, ADC_HC_AIEN);
+        #else
+        return async_interrupt && atomic::getBitFlag(adc_regs.SC1A, ADC_SC1_AIEN);
+        #endif
+    }
+
+    // the conversion async_id is complete, read it and resume the coroutine
+    void asyncISR();
+
+    // stops the conversion async_id (if it's still converting), restores what it interrupted and frees the interrupt
+    void stopAsync();
+
+    // resumes the coroutine waiting for async_id, if any
+    void resumeAwaiting();
+
+    // the ADC interrupts call the queueISR or asyncISR of these modules
+    static ADC_Module* queue_modules[ADC_NUM_ADCS];
+    static void queue_isr0() {
+        queue_modules[0]->queueISR();
+    }
+    static void async_isr0() {
+        queue_modules[0]->asyncISR();
+    }
+    #ifdef ADC_DUAL_ADCS
+    static void queue_isr1() {
+        queue_modules[1]->queueISR();
+    }
+    static void async_isr1() {
+        queue_modules[1]->asyncISR();
+    }
+    #endif
+
+    // checks before starting a single conversion and suspends the current one, see startSingleRead
+    bool prepareSingleRead(ADC_PRIORITY priority);
+
+    // frequency of the ADC clock with the current settings
+    uint32_t getADCClock();
+
+    // is the calibration running in the hardware?
+    bool calibrationRunning();
+
+    // the calibration finished, write the registers
+    void calibrationDone();
+
+    #if ADC_CALIB_CACHE_SIZE > 0
+    // calibration results of one conversion speed and reference
+    struct CalibrationEntry {
+        bool valid;
+        ADC_CONVERSION_SPEED speed;
+        ADC_REF_SOURCE reference;
+        #ifdef ADC_TEENSY_4
+        uint32_t cal;
+        #else
+        uint16_t ofs, pg, mg;
+        #endif
+    };
+    CalibrationEntry calib_cache[ADC_CALIB_CACHE_SIZE];
+    // next entry to replace when the cache is full
+    uint8_t calib_cache_next;
+
+    // contents of the EEPROM, see saveCalibration
+    struct CalibrationRecord {
+        uint32_t magic;
+        uint32_t fingerprint;
+        CalibrationEntry entries[ADC_CALIB_CACHE_SIZE];
+        uint32_t checksum;
+    };
+
+    static constexpr uint32_t CALIBRATION_MAGIC = 0x41444343; // "ADCC"
+
+    // board, clocks and module that made the calibration
+    uint32_t calibrationFingerprint();
+
+    // checksum of the record, except the checksum itself
+    static uint32_t calibrationChecksum(const CalibrationRecord &record);
+
+    // calibration to compare with, see startCalibrationCheck
+    CalibrationEntry calib_check_ref;
+    uint16_t calib_check_max_difference;
+    bool calib_check_pending;
+    bool calib_drifted;
+
+    // compare the new calibration with calib_check_ref
+    void finishCalibrationCheck();
+
+    // find the entry for the current conversion speed and reference, nullptr if there's none
+    CalibrationEntry* findCalibration();
+
+    // store the registers after a successful calibration
+    void storeCalibration();
+    #endif
+
     // resolution
     uint8_t analog_res_bits;
 
@@ -723,6 +1394,11 @@ private:
     //! Initialize ADC
     void analog_init();
 
+    // set the registers of the reference or the conversion speed, they return false if nothing changed.
+    // setReference and setConversionSpeed calibrate after them, analog_init only once for both
+    bool writeReference(ADC_REF_SOURCE ref_type);
+    bool writeConversionSpeed(ADC_CONVERSION_SPEED speed);
+
     //! Switch on clock to ADC
     void startClock() {
         #if defined(ADC_TEENSY_4)
@@ -748,12 +1424,23 @@ private:
 
     #ifdef ADC_USE_PDB
     reg PDB0_CHnC1; // PDB channel 0 or 1
+    reg PDB0_CHnDLY0; // delay of pretrigger 0 (SC1A)
+    reg PDB0_CHnDLY1; // delay of pretrigger 1 (SC1B)
+
+    //! Calculate the PDB mod, prescaler and mult for the frequency, return false if it's out of range
+    bool getPDBSettings(uint32_t freq, uint32_t &mod, uint8_t &prescaler, uint8_t &mult);
     #endif
     #ifdef ADC_TEENSY_4
     uint8_t XBAR_IN;
     uint8_t XBAR_OUT;
     uint8_t QTIMER4_INDEX;
     uint8_t ADC_ETC_TRIGGER_INDEX;    
+
+    // number of conversions per trigger programmed in the ADC_ETC
+    uint8_t etc_chain_length;
+
+    //! Program the XBAR, ADC_ETC chain and QuadTimer for this ADC, trig_ctrl is added to the trigger control register
+    void startQuadTimerTrigger(const uint8_t *adc_channels, uint8_t num_channels, uint32_t freq, uint32_t trig_ctrl = 0);
     #endif
     const IRQ_NUMBER_t IRQ_ADC; // IRQ number
 
@@ -0,0 +1,113 @@
+/* Teensy 4, 3.x, LC ADC library
+ * https://github.com/pedvide/ADC
+ * Copyright (c) 2019 Pedro Villanueva
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* ADC_Trace.cpp: Optional log of what the ADC modules do, with cycle timestamps.
+ */
+
+#include "ADC_Trace.h"
+
+#ifdef ADC_TRACE
+
+namespace ADC_Trace {
+
+    static_assert(sizeof(Record) == 12, "ADC_Trace::Record must be 12 bytes, it's the format of dump()");
+
+    static Record ring[ADC_TRACE_SIZE];
+    static uint32_t head = 0; // number of records logged
+    static uint32_t tail = 0; // first record not dumped
+    static uint32_t lost_records = 0;
+
+    /* Adds a record to the ring, overwriting the oldest one if it's full
+    *
+    */
+    void log(Event event, uint8_t adc_num, uint32_t data) {
+        // it's called inside the critical sections of the library too, it must not enable the interrupts there
+        const bool irq_enabled = ADC_Cpu::disableIRQ();
+        if (head - tail == ADC_TRACE_SIZE) {
+            tail++;
+            lost_records++;
+        }
+        Record &record = ring[head % ADC_TRACE_SIZE];
+        record.timestamp = ADC_Cpu::cycles();
+        record.data = data;
+        record.sequence = head;
+        record.event = event;
+        record.adc_num = adc_num;
+        head++;
+        ADC_Cpu::restoreIRQ(irq_enabled);
+    }
+
+    uint32_t available() {
+        return head - tail;
+    }
+
+    uint32_t lost() {
+        return lost_records;
+    }
+
+    void clear() {
+        const bool irq_enabled = ADC_Cpu::disableIRQ();
+        tail = head;
+        lost_records = 0;
+        ADC_Cpu::restoreIRQ(irq_enabled);
+    }
+
+    /* Sends the header and the records, one at a time so the interrupts are disabled only to copy each one
+    *  New records are left for the next dump.
+    */
+    uint16_t dump(Print &out) {
+        bool irq_enabled = ADC_Cpu::disableIRQ();
+        uint16_t count = head - tail;
+        const uint32_t lost_count = lost_records;
+        lost_records = 0;
+        ADC_Cpu::restoreIRQ(irq_enabled);
+
+        #if defined(ADC_TEENSY_4)
+        const uint32_t cycles_per_second = F_CPU_ACTUAL;
+        #else
+        const uint32_t cycles_per_second = F_CPU;
+        #endif
+        const uint8_t header[16] = {'A', 'D', 'C', 'T', 1, sizeof(Record),
+                                    (uint8_t)count, (uint8_t)(count >> 8),
+                                    (uint8_t)lost_count, (uint8_t)(lost_count >> 8),
+                                    (uint8_t)(lost_count >> 16), (uint8_t)(lost_count >> 24),
+                                    (uint8_t)cycles_per_second, (uint8_t)(cycles_per_second >> 8),
+                                    (uint8_t)(cycles_per_second >> 16), (uint8_t)(cycles_per_second >> 24)};
+        out.write(header, sizeof(header));
+
+        for (uint16_t i = 0; i < count; i++) {
+            irq_enabled = ADC_Cpu::disableIRQ();
+            // the ring was full and the record was overwritten, send the next one (its sequence tells)
+            const Record record = ring[tail % ADC_TRACE_SIZE];
+            tail++;
+            ADC_Cpu::restoreIRQ(irq_enabled);
+            out.write((const uint8_t*)&record, sizeof(record));
+        }
+        return count;
+    }
+
+}
+
+#endif // ADC_TRACE
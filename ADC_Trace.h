@@ -0,0 +1,118 @@
+/* Teensy 4, 3.x, LC ADC library
+ * https://github.com/pedvide/ADC
+ * Copyright (c) 2019 Pedro Villanueva
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* ADC_Trace.h: Optional log of what the ADC modules do, with cycle timestamps.
+ */
+
+/*! \page trace ADC event trace
+If ADC_TRACE is defined (uncomment it below) the library logs its events (conversions, preemptions,
+calibrations, DMA blocks, timers, failed comparisons) to a ring of ADC_TRACE_SIZE records,
+each with the cycle counter and the ADC number. When the ring is full the oldest records are lost.
+ADC_Trace::dump() sends the records in binary, for example over Serial, to be decoded in the computer.
+If ADC_TRACE is not defined the events are removed by the preprocessor and cost nothing.
+See the namespace ADC_Trace for all functions.
+*/
+
+#ifndef ADC_TRACE_H
+#define ADC_TRACE_H
+
+#include <settings_defines.h>
+
+// Uncomment to log the events of the ADC modules
+//#define ADC_TRACE
+
+#ifdef ADC_TRACE
+
+// Number of records in the ring, it must be a power of 2
+#ifndef ADC_TRACE_SIZE
+#define ADC_TRACE_SIZE (256)
+#endif
+
+//! Log of the events of the ADC modules
+namespace ADC_Trace {
+
+    static_assert((ADC_TRACE_SIZE & (ADC_TRACE_SIZE - 1)) == 0, "ADC_TRACE_SIZE must be a power of 2");
+
+    //! Events, the meaning of the data of each one is in its description
+    enum class Event : uint8_t {
+        CONVERSION_START = 1, /*!< A conversion started, data: the channel (SC1A/HC0). */
+        CONVERSION_COMPLETE, /*!< A conversion was read, data: the result. */
+        PREEMPT, /*!< A conversion saved the state of the ADC and stopped it, data: 1 if it was a stream. */
+        RESUME, /*!< The state saved by a PREEMPT was restored. */
+        CALIBRATION_START, /*!< The hardware calibration started. */
+        CALIBRATION_END, /*!< The calibration ended, data: 0 succeeded, 1 failed, 2 restored from the cache. */
+        DMA_BLOCK, /*!< AnalogBufferDMA filled a block, data: its sequence number. */
+        TIMER_START, /*!< The PDB or QuadTimer started, data: the frequency in Hz. */
+        TIMER_STOP, /*!< The PDB or QuadTimer stopped. */
+        COMPARISON_FAILED, /*!< A conversion didn't pass the comparison. */
+    };
+
+    //! One event, this is also the binary format of dump() (little endian)
+    struct Record {
+        uint32_t timestamp; //!< cycle counter (Teensy LC: computed from millis and the SysTick)
+        uint32_t data; //!< depends on the event
+        uint16_t sequence; //!< number of the record, gaps mean lost records
+        Event event; //!< what happened
+        uint8_t adc_num; //!< which ADC
+    };
+
+    //! Adds a record to the ring, it can be called from interrupts
+    /** \param event what happened.
+    *   \param adc_num which ADC.
+    *   \param data depends on the event.
+    */
+    void log(Event event, uint8_t adc_num, uint32_t data = 0);
+
+    //! Number of records waiting to be dumped
+    uint32_t available();
+
+    //! Number of records overwritten before being dumped
+    uint32_t lost();
+
+    //! Removes all records
+    void clear();
+
+    //! Sends the records in binary and removes them
+    /** It sends a header followed by the records, everything little endian:
+    *   "ADCT" (4 bytes), version (1 byte, 1), size of a Record (1 byte, 12), number of records (2 bytes),
+    *   lost records since the last dump (4 bytes) and cycles per second of the timestamps (4 bytes).
+    *   \param out where to send them, for example Serial.
+    *   \return the number of records sent.
+    */
+    uint16_t dump(Print &out);
+
+}
+
+//! Log an event of the ADC
+#define ADC_TRACE_EVENT(event, adc_num, data) ADC_Trace::log(ADC_Trace::Event::event, adc_num, data)
+
+#else
+
+//! Log an event of the ADC
+#define ADC_TRACE_EVENT(event, adc_num, data) do {} while(0)
+
+#endif // ADC_TRACE
+
+#endif // ADC_TRACE_H
@@ -30,18 +30,24 @@
 //#define DEBUG_DUMP_DATA
 // Global objects
 AnalogBufferDMA *AnalogBufferDMA::_activeObjectPerADC[2] = {nullptr, nullptr};
+uint32_t AnalogBufferDMA::_cycles_high = 0;
+uint32_t AnalogBufferDMA::_cycles_last = 0;
 
 #if defined(__IMXRT1062__)  // Teensy 4.0
 #define SOURCE_ADC_0    ADC1_R0
 #define DMAMUX_ADC_0    DMAMUX_SOURCE_ADC1
+#define SCAN_ADC_0      ADC1_HC0
 #define SOURCE_ADC_1    ADC2_R0
 #define DMAMUX_ADC_1    DMAMUX_SOURCE_ADC2
+#define SCAN_ADC_1      ADC2_HC0
 #elif defined(KINETISK)
 #define SOURCE_ADC_0    ADC0_RA
 #define DMAMUX_ADC_0    DMAMUX_SOURCE_ADC0
+#define SCAN_ADC_0      ADC0_SC1A
 #ifdef ADC_DUAL_ADCS
 #define SOURCE_ADC_1    ADC1_RA
 #define DMAMUX_ADC_1    DMAMUX_SOURCE_ADC1
+#define SCAN_ADC_1      ADC1_SC1A
 #endif
 #elif defined(KINETISL)
 #define SOURCE_ADC_0    ADC0_RA
@@ -72,6 +78,44 @@ static void dumpDMA_TCD(DMABaseClass *dmabc)
 
 
 
+//=============================================================================
+// Constructor for one region split in num_blocks blocks
+//=============================================================================
+AnalogBufferDMA::AnalogBufferDMA(volatile uint16_t *region, uint32_t region_count, uint16_t num_blocks,
+                                 DMASetting *settings) :
+        _buffer1(region), _buffer1_count(region_count), _buffer2(nullptr), _buffer2_count(0)
+{
+  _block_samples = num_blocks ? region_count / num_blocks : 0;
+  _circular = true;
+  if (num_blocks > ADC_DMA_MAX_SETTINGS) {
+    _max_blocks = num_blocks;
+    _block_timestamp = new uint64_t[num_blocks];
+#ifndef KINETISL
+    // DMASettings need 32 byte alignment, which new doesn't guarantee, init fails without them
+    if (settings) _dmasettings = settings;
+    else _max_blocks = ADC_DMA_MAX_SETTINGS;
+#endif
+  }
+}
+
+//=============================================================================
+// Destructor: stop the DMA before freeing what the ISRs use
+//=============================================================================
+AnalogBufferDMA::~AnalogBufferDMA()
+{
+  _dmachannel_adc.disable();
+  for (uint8_t i = 0; i < 2; i++) {
+    if (_activeObjectPerADC[i] == this) _activeObjectPerADC[i] = nullptr;
+  }
+#ifndef KINETISL
+  delete _dmachannel_scan;  // the DMAChannel destructors release the channels
+#ifdef ADC_DUAL_ADCS
+  delete _dmachannel_sync;
+#endif
+#endif
+  if (_block_timestamp != _timestamps) delete[] _block_timestamp;
+}
+
 //=============================================================================
 // Init - Initialize the object including setup DMA structures
 //=============================================================================
@@ -82,41 +126,57 @@ void AnalogBufferDMA::init(ADC *adc, int8_t adc_num)
   Serial.println("AnalogBufferDMA::init"); Serial.flush();
 #endif
 
+  // Split the buffers in blocks of _block_samples (or one block per buffer)
+  if (_block_samples && ((_buffer1_count % _block_samples) || (_buffer2 && (_buffer2_count % _block_samples)))) {
+    adc->adc[adc_num]->fail_flag |= ADC_ERROR::OTHER;
+    _block_samples = 0;
+  }
+  _num_blocks1 = _block_samples ? _buffer1_count / _block_samples : 1;
+  _num_blocks = _num_blocks1 + ((_buffer2 && _buffer2_count) ? (_block_samples ? _buffer2_count / _block_samples : 1) : 0);
+
+  // Half of a single buffer doesn't need more settings, the channel interrupts at half and at completion
+  bool half_buffer = !_buffer2 && (_num_blocks == 2);
+  if (_num_blocks > _max_blocks) {
+    adc->adc[adc_num]->fail_flag |= ADC_ERROR::OTHER;
+    _block_samples = 0;
+    _num_blocks1 = 1;
+    _num_blocks = (_buffer2 && _buffer2_count) ? 2 : 1;
+  }
+
+  ADC_Cpu::beginCycles(); // for the timestamps of the blocks
+
 #ifndef KINETISL
-  // setup a DMA Channel.
-  // Now lets see the different things that RingbufferDMA setup for us before
   // See if we were created with one or two buffers.  If one assume we stop on completion, else assume continuous.
-  if (_buffer2 && _buffer2_count) {
-    #ifdef ADC_DUAL_ADCS
-    _dmasettings_adc[0].source((volatile uint16_t&)((adc_num == 1) ? SOURCE_ADC_1 : SOURCE_ADC_0));
-    #else
-    _dmasettings_adc[0].source((volatile uint16_t&)(SOURCE_ADC_0));
-    #endif
-    _dmasettings_adc[0].destinationBuffer((uint16_t*)_buffer1, _buffer1_count * 2); // 2*b_size is necessary for some reason
-    _dmasettings_adc[0].replaceSettingsOnCompletion(_dmasettings_adc[1]);    // go off and use second one...
-    _dmasettings_adc[0].interruptAtCompletion(); //interruptAtHalf or interruptAtCompletion
-    #ifdef ADC_DUAL_ADCS
-    _dmasettings_adc[1].source((volatile uint16_t&)((adc_num == 1) ? SOURCE_ADC_1 : SOURCE_ADC_0));
-    _dmasettings_adc[1].destinationBuffer((uint16_t*)_buffer2, _buffer2_count * 2); // 2*b_size is necessary for some reason
-    _dmasettings_adc[1].replaceSettingsOnCompletion(_dmasettings_adc[0]);    // Cycle back to the first one
-    _dmasettings_adc[1].interruptAtCompletion(); //interruptAtHalf or interruptAtCompletion
-    #endif
+  _stop_on_completion = !(_buffer2 && _buffer2_count) && !_circular;
 
-    _dmachannel_adc = _dmasettings_adc[0];
+  #ifdef ADC_DUAL_ADCS
+  volatile uint16_t &source = (volatile uint16_t&)((adc_num == 1) ? SOURCE_ADC_1 : SOURCE_ADC_0);
+  #else
+  volatile uint16_t &source = (volatile uint16_t&)(SOURCE_ADC_0);
+  #endif
 
-    _stop_on_completion = false;
-  } else {
+  // setup a DMA Channel.
+  if ((_num_blocks == 1) || half_buffer) {
     // Only one buffer so lets just setup the dmachannel ...
     // Serial.printf("AnalogBufferDMA::init Single buffer %d\n", adc_num);
-    #ifdef ADC_DUAL_ADCS
-    _dmachannel_adc.source((volatile uint16_t&)((adc_num == 1) ? SOURCE_ADC_1 : SOURCE_ADC_0));
-    #else
-    _dmachannel_adc.source((volatile uint16_t&)(SOURCE_ADC_0));
-    #endif
+    _num_settings = 0;
+    _dmachannel_adc.source(source);
     _dmachannel_adc.destinationBuffer((uint16_t*)_buffer1, _buffer1_count * 2); // 2*b_size is necessary for some reason
     _dmachannel_adc.interruptAtCompletion(); //interruptAtHalf or interruptAtCompletion
-    _dmachannel_adc.disableOnCompletion();    // we will disable on completion.
-    _stop_on_completion = true;
+    if (half_buffer) _dmachannel_adc.interruptAtHalf();
+    if (_stop_on_completion) _dmachannel_adc.disableOnCompletion();    // a region keeps going round
+  } else {
+    // One setting per block, each one goes off and uses the next one, the last one cycles back to the first one
+    _num_settings = _num_blocks;
+    for (uint16_t i = 0; i < _num_settings; i++) {
+      _dmasettings[i].source(source);
+      _dmasettings[i].destinationBuffer((uint16_t*)blockBuffer(i), blockCount(i) * 2); // 2*b_size is necessary for some reason
+      _dmasettings[i].replaceSettingsOnCompletion(_dmasettings[(i + 1) % _num_settings]);
+      _dmasettings[i].interruptAtCompletion(); //interruptAtHalf or interruptAtCompletion
+    }
+    if (_stop_on_completion) _dmasettings[_num_settings - 1].disableOnCompletion();
+
+    _dmachannel_adc = _dmasettings[0];
   }
 
   if (adc_num == 1) {
@@ -138,8 +198,7 @@ void AnalogBufferDMA::init(ADC *adc, int8_t adc_num)
 
 #ifdef DEBUG_DUMP_DATA
   dumpDMA_TCD(&_dmachannel_adc);
-  dumpDMA_TCD(&_dmasettings_adc[0]);
-  dumpDMA_TCD(&_dmasettings_adc[1]);
+  for (uint16_t i = 0; i < _num_settings; i++) dumpDMA_TCD(&_dmasettings[i]);
 #if defined(__IMXRT1062__)  // Teensy 4.0
 
   if (adc_num == 1) {
@@ -154,7 +213,7 @@ void AnalogBufferDMA::init(ADC *adc, int8_t adc_num)
   // setup a DMA Channel.
   // Now lets see the different things that RingbufferDMA setup for us before
   _dmachannel_adc.source((volatile uint16_t&)(SOURCE_ADC_0));;
-  _dmachannel_adc.destinationBuffer((uint16_t*)_buffer1, _buffer1_count * 2); // 2*b_size is necessary for some reason
+  _dmachannel_adc.destinationBuffer((uint16_t*)blockBuffer(0), blockCount(0) * 2); // 2*b_size is necessary for some reason
   _dmachannel_adc.disableOnCompletion();    // ISR will hae to restart with other buffer
   _dmachannel_adc.interruptAtCompletion(); //interruptAtHalf or interruptAtCompletion
   _activeObjectPerADC[0] = this;
@@ -171,7 +230,159 @@ void AnalogBufferDMA::init(ADC *adc, int8_t adc_num)
 #endif
 
   _last_isr_time = millis();
+  _interrupt_count = 0;
+  _read_sequence = _block_sequence = 0;
+  _overrun_count = 0;
+  _first_timestamp = 0;
+}
+
+#ifndef KINETISL
+//=============================================================================
+// initScan - Initialize the object to convert a list of pins in turns
+//=============================================================================
+bool AnalogBufferDMA::initScan(ADC *adc, int8_t adc_num, const uint8_t *pins, uint8_t num_pins)
+{
+  ADC_Module *adc_module = adc->adc[adc_num];
+
+  if ((num_pins == 0) || (num_pins > ADC_MAX_SCAN_PINS)) {
+    adc_module->fail_flag |= ADC_ERROR::OTHER;
+    return false;
+  }
+  // the minor loop link leaves only 9 bits for the count of each block, and each block must start with pins[0]
+  uint32_t block1_count = _block_samples ? _block_samples : _buffer1_count;
+  uint32_t block2_count = _block_samples ? _block_samples : _buffer2_count;
+  if ((block1_count > 511) || (_buffer1_count % num_pins)
+      || (_buffer2 && ((block2_count > 511) || (_buffer2_count % num_pins)))
+      || (_block_samples % num_pins)) {
+    adc_module->fail_flag |= ADC_ERROR::OTHER;
+    return false;
+  }
+
+  #ifdef ADC_DUAL_ADCS
+  const uint8_t *channel2sc1a = (adc_num == 1) ? ADC::channel2sc1aADC1 : ADC::channel2sc1aADC0;
+  #else
+  const uint8_t *channel2sc1a = ADC::channel2sc1aADC0;
+  #endif
+
+  // the value written after the result of pins[i] starts the conversion of pins[i+1]
+  for (uint8_t i = 0; i < num_pins; i++) {
+    if (!adc_module->checkPin(pins[i]) || ((channel2sc1a[pins[i]] ^ channel2sc1a[pins[0]]) & ADC_SC1A_PIN_MUX)) {
+      adc_module->fail_flag |= ADC_ERROR::WRONG_PIN;
+      return false;
+    }
+    _scan_table[(i + num_pins - 1) % num_pins] = channel2sc1a[pins[i]] & ADC_SC1A_CHANNELS;
+  }
+
+  init(adc, adc_num);
+  _dmachannel_adc.disable();
+
+  if (!_dmachannel_scan) _dmachannel_scan = new DMAChannel();
+  _dmachannel_scan->sourceBuffer(_scan_table, num_pins * 4);
+  #ifdef ADC_DUAL_ADCS
+  _dmachannel_scan->destination((volatile uint32_t&)((adc_num == 1) ? SCAN_ADC_1 : SCAN_ADC_0));
+  #else
+  _dmachannel_scan->destination((volatile uint32_t&)(SCAN_ADC_0));
+  #endif
+
+  // write the next pin after every result, including the last one of each buffer
+  _dmachannel_scan->triggerAtTransfersOf(_dmachannel_adc);
+  _dmachannel_scan->triggerAtCompletionOf(_dmachannel_adc);
+  for (uint16_t i = 0; i < _num_settings; i++) {
+    _dmachannel_scan->triggerAtTransfersOf(_dmasettings[i]);
+    _dmachannel_scan->triggerAtCompletionOf(_dmasettings[i]);
+  }
+  _dmachannel_scan->enable();
+  _dmachannel_adc.enable();
+
+  // selects the mux and starts the conversion of the first pin, each result starts the next one.
+  // startSingleRead would stop the DMA that init() enabled
+  adc_module->wait_for_cal();
+  adc_module->singleMode();
+  adc_module->startReadFast(pins[0]);
+
+#ifdef DEBUG_DUMP_DATA
+  dumpDMA_TCD(_dmachannel_scan);
+  dumpDMA_TCD(&_dmachannel_adc);
+#endif
+  return true;
+}
+#endif
+
+#if defined(ADC_DUAL_ADCS) && !defined(KINETISL)
+//=============================================================================
+// initSynchronized - Initialize the object to store the results of both ADCs
+//    as interleaved pairs, see ADC::startSynchronizedTimer
+//=============================================================================
+bool AnalogBufferDMA::initSynchronized(ADC *adc)
+{
+  // ADC1 writes the whole buffer in one go, it can't follow the blocks through two buffers
+  if ((_buffer2 && _buffer2_count) || (_buffer1_count & 1) || (_block_samples & 1)) {
+    adc->adc0->fail_flag |= ADC_ERROR::OTHER;
+    return false;
+  }
+
+  init(adc, 0);
+
+  // ADC0 writes the even positions: skip one sample after each result, half as many results per block.
+  // The bytes per block don't change, so the DLASTSGA set by destinationBuffer still wraps correctly.
+  _dmachannel_adc.disable();
+  _dmachannel_adc.TCD->DOFF = 4;
+  _dmachannel_adc.TCD->CITER = _dmachannel_adc.TCD->BITER = _dmachannel_adc.TCD->BITER / 2;
+  for (uint16_t i = 0; i < _num_settings; i++) {
+    _dmasettings[i].TCD->DOFF = 4;
+    _dmasettings[i].TCD->CITER = _dmasettings[i].TCD->BITER = _dmasettings[i].TCD->BITER / 2;
+  }
+
+  // ADC1 writes the odd positions of the whole buffer, the blocks and interrupts come from ADC0.
+  // Both modules convert at the same time, so its results are in place when the ADC0 block is complete.
+  if (!_dmachannel_sync) _dmachannel_sync = new DMAChannel();
+  _dmachannel_sync->source((volatile uint16_t&)(SOURCE_ADC_1));
+  _dmachannel_sync->destinationBuffer((uint16_t*)_buffer1 + 1, _buffer1_count * 2);
+  _dmachannel_sync->TCD->DOFF = 4;
+  _dmachannel_sync->TCD->CITER = _dmachannel_sync->TCD->BITER = _buffer1_count / 2;
+  if (_stop_on_completion) _dmachannel_sync->disableOnCompletion();
+  _dmachannel_sync->triggerAtHardwareEvent(DMAMUX_ADC_1);
+  _dmachannel_sync->enable();
+  _dmachannel_adc.enable();
+
+  adc->adc1->continuousMode();
+  adc->adc1->enableDMA();
+
+#ifdef DEBUG_DUMP_DATA
+  dumpDMA_TCD(_dmachannel_sync);
+  dumpDMA_TCD(&_dmachannel_adc);
+  for (uint16_t i = 0; i < _num_settings; i++) dumpDMA_TCD(&_dmasettings[i]);
+#endif
+  return true;
+}
+#endif
+
+#ifdef ADC_USE_PDB
+//=============================================================================
+// initPingPong - Initialize the object to read RA and RB in turns, see
+//    ADC_Module::startPDBPingPong
+//=============================================================================
+void AnalogBufferDMA::initPingPong(ADC *adc, int8_t adc_num)
+{
+  init(adc, adc_num);
+
+  // RB follows RA, move the source 4 bytes after each sample and wrap it
+  // around every 8 bytes (source modulo of 2^3), RA is 8 byte aligned.
+  _dmachannel_adc.disable();
+  _dmachannel_adc.TCD->SOFF = 4;
+  _dmachannel_adc.TCD->ATTR_SRC |= (3 << 3);
+  for (uint16_t i = 0; i < _num_settings; i++) {
+    _dmasettings[i].TCD->SOFF = 4;
+    _dmasettings[i].TCD->ATTR_SRC |= (3 << 3);
+  }
+  _dmachannel_adc.enable();
+
+#ifdef DEBUG_DUMP_DATA
+  dumpDMA_TCD(&_dmachannel_adc);
+  for (uint16_t i = 0; i < _num_settings; i++) dumpDMA_TCD(&_dmasettings[i]);
+#endif
 }
+#endif
 
 //=============================================================================
 // stopOnCompletion: allows you to turn on or off stopping when a DMA buffer
@@ -181,8 +392,22 @@ void AnalogBufferDMA::init(ADC *adc, int8_t adc_num)
 void AnalogBufferDMA::stopOnCompletion(bool stop_on_complete)
 {
 #ifndef KINETISL
-  if (stop_on_complete) _dmachannel_adc.TCD->CSR |= DMA_TCD_CSR_DREQ;
-  else _dmachannel_adc.TCD->CSR &= ~DMA_TCD_CSR_DREQ;
+  // with several settings the last one stops the channel when it completes,
+  // the channel runs a copy of the current one so change it too if it's the last one.
+  if (_num_settings) {
+    if (stop_on_complete) _dmasettings[_num_settings - 1].TCD->CSR |= DMA_TCD_CSR_DREQ;
+    else _dmasettings[_num_settings - 1].TCD->CSR &= ~DMA_TCD_CSR_DREQ;
+  }
+  if (!_num_settings || ((_interrupt_count % _num_settings) == (uint32_t)(_num_settings - 1))) {
+    if (stop_on_complete) _dmachannel_adc.TCD->CSR |= DMA_TCD_CSR_DREQ;
+    else _dmachannel_adc.TCD->CSR &= ~DMA_TCD_CSR_DREQ;
+  }
+#ifdef ADC_DUAL_ADCS
+  if (_dmachannel_sync) {
+    if (stop_on_complete) _dmachannel_sync->TCD->CSR |= DMA_TCD_CSR_DREQ;
+    else _dmachannel_sync->TCD->CSR &= ~DMA_TCD_CSR_DREQ;
+  }
+#endif
 #else
   if (stop_on_complete) _dmachannel_adc.CFG->DCR |= DMA_DCR_D_REQ;
   else _dmachannel_adc.CFG->DCR &= ~DMA_DCR_D_REQ;
@@ -200,9 +425,91 @@ bool AnalogBufferDMA::clearCompletion()
   if (!_stop_on_completion) return false;
   // should probably check to see if we are dsiable or not...
   _dmachannel_adc.enable();
+#if defined(ADC_DUAL_ADCS) && !defined(KINETISL)
+  if (_dmachannel_sync) _dmachannel_sync->enable();
+#endif
   return true;
 }
 
+//=============================================================================
+// readBlock: get the oldest filled block that hasn't been committed yet.
+//=============================================================================
+bool AnalogBufferDMA::readBlock(Block &block)
+{
+  uint32_t write_sequence = __atomic_load_n(&_interrupt_count, __ATOMIC_ACQUIRE);
+  uint32_t sequence = _read_sequence;
+  if (write_sequence == sequence) return false;
+
+  // skip the blocks that were already overwritten (counted as overruns by the isr)
+  uint32_t in_flight = blocksInFlight();
+  if ((write_sequence - sequence) > in_flight) {
+    sequence = write_sequence - in_flight;
+  }
+
+  _block_sequence = sequence;
+  block.buffer = blockBuffer(sequence);
+  block.count = blockCount(sequence);
+  block.sequence = sequence;
+  block.timestamp = _block_timestamp[sequence % _num_blocks];
+  block.first_sample = blockFirstSample(sequence);
+#if defined(__IMXRT1062__)  // Teensy 4.0
+  // the DMA wrote the block behind the back of the cache, only DMAMEM (OCRAM) is cached
+  if ((uint32_t)block.buffer >= 0x20200000) arm_dcache_delete((void*)block.buffer, block.count * 2);
+#endif
+  return true;
+}
+
+//=============================================================================
+// commitBlock: release the block returned by readBlock so it can be filled again.
+//=============================================================================
+bool AnalogBufferDMA::commitBlock()
+{
+  uint32_t write_sequence = __atomic_load_n(&_interrupt_count, __ATOMIC_ACQUIRE);
+  bool valid = (write_sequence - _block_sequence) <= blocksInFlight();
+
+  __atomic_store_n(&_read_sequence, _block_sequence + 1, __ATOMIC_RELEASE);
+
+  // the DMA stopped after filling this block, start it again.
+  if (_stop_on_completion && valid && (_block_sequence + 1 == write_sequence)) clearCompletion();
+  return valid;
+}
+
+//=============================================================================
+// cycleCount: CPU cycle counter extended to 64 bits, it has to be called at
+//    least once per overflow of the 32 bit counter (every few seconds), the
+//    DMA ISRs do that while running. It can be called with the interrupts
+//    disabled, it leaves them as they were.
+//=============================================================================
+uint64_t AnalogBufferDMA::cycleCount()
+{
+  const bool irq_enabled = ADC_Cpu::irqEnabled();
+  if (irq_enabled) ADC_DISABLE_IRQ();
+  uint32_t cycles = ADC_Cpu::cycles();
+  if (cycles < _cycles_last) _cycles_high++;
+  _cycles_last = cycles;
+  uint32_t high = _cycles_high;
+  if (irq_enabled) ADC_ENABLE_IRQ();
+  return ((uint64_t)high << 32) | cycles;
+}
+
+//=============================================================================
+// sampleRate: samples per second measured between the end of the first block
+//    and the end of the last one.
+//=============================================================================
+float AnalogBufferDMA::sampleRate()
+{
+  uint32_t write_sequence = __atomic_load_n(&_interrupt_count, __ATOMIC_ACQUIRE);
+  if (write_sequence < 2) return 0;
+  uint64_t samples = blockFirstSample(write_sequence) - blockFirstSample(1);
+  uint64_t cycles = _block_timestamp[(write_sequence - 1) % _num_blocks] - _first_timestamp;
+  if (!cycles) return 0;
+#if defined(__IMXRT1062__)  // Teensy 4.0
+  return (float)samples * F_CPU_ACTUAL / cycles;
+#else
+  return (float)samples * F_CPU / cycles;
+#endif
+}
+
 //=============================================================================
 // processADC_DMAISR: Process the DMA completion ISR
 //     common for both ISRs on those processors who have more than one ADC
@@ -211,24 +518,38 @@ void  AnalogBufferDMA::processADC_DMAISR() {
   //digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN));
   uint32_t cur_time = millis();
 
-  _interrupt_count++;
+  // publish the block after its data and timestamp
+  uint32_t write_sequence = _interrupt_count + 1;
+  _block_timestamp[(write_sequence - 1) % _num_blocks] = cycleCount();
+  if (write_sequence == 1) _first_timestamp = _block_timestamp[0];
+  __atomic_store_n(&_interrupt_count, write_sequence, __ATOMIC_RELEASE);
+  ADC_TRACE_EVENT(DMA_BLOCK, (_activeObjectPerADC[1] == this) ? 1 : 0, write_sequence);
+  // the block now being filled overwrites one the consumer didn't commit
+  if ((write_sequence - __atomic_load_n(&_read_sequence, __ATOMIC_ACQUIRE)) > blocksInFlight()) {
+    __atomic_store_n(&_overrun_count, _overrun_count + 1, __ATOMIC_RELAXED);
+  }
   _interrupt_delta_time = cur_time - _last_isr_time;
   _last_isr_time = cur_time;
   // update the internal buffer positions
   _dmachannel_adc.clearInterrupt();
 #ifdef KINETISL
-  // Lets try to clear the previous interrupt, change buffers
+  // Lets try to clear the previous interrupt, change to the next block
   // and restart
-  if (_buffer2 && (_interrupt_count & 1)) {
-    _dmachannel_adc.destinationBuffer((uint16_t*)_buffer2, _buffer2_count * 2); // 2*b_size is necessary for some reason
-  } else {
-    _dmachannel_adc.destinationBuffer((uint16_t*)_buffer1, _buffer1_count * 2); // 2*b_size is necessary for some reason
-  }
+  _dmachannel_adc.destinationBuffer((uint16_t*)blockBuffer(write_sequence), blockCount(write_sequence) * 2); // 2*b_size is necessary for some reason
 
-  // If we are not stopping on completion, then reenable...
-  if (!_stop_on_completion) _dmachannel_adc.enable();
+  // If we are not stopping on completion or the buffer isn't full yet, then reenable...
+  if (!_stop_on_completion || (write_sequence % _num_blocks)) _dmachannel_adc.enable();
 
 #endif
+
+  // the callback consumes the blocks, in case some isr was late there may be more than one
+  if (_block_callback) {
+    Block block;
+    while (readBlock(block)) {
+      _block_callback(this, block);
+      commitBlock();
+    }
+  }
 }
 
 //=============================================================================
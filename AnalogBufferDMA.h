@@ -30,12 +30,28 @@
 
 #include "DMAChannel.h"
 #include "ADC.h"
+
+// max number of pins in a scan, see initScan
+#ifndef ADC_MAX_SCAN_PINS
+#define ADC_MAX_SCAN_PINS 16
+#endif
+
+// max number of blocks when the buffers are split with samplesPerInterrupt, each one uses a DMASetting
+#ifndef ADC_DMA_MAX_SETTINGS
+#define ADC_DMA_MAX_SETTINGS 8
+#endif
+
 // lets wrap some of our Dmasettings stuff into helper class
 class AnalogBufferDMA {
     // keep our settings and the like:
 public: // At least temporary to play with dma settings. 
 #ifndef KINETISL
-    DMASetting  _dmasettings_adc[2];
+    DMASetting  _dmasettings_adc[ADC_DMA_MAX_SETTINGS];
+    DMASetting  *_dmasettings = _dmasettings_adc;    // settings used for the blocks, see the constructor with a region
+    DMAChannel  *_dmachannel_scan = nullptr; // only allocated by initScan
+#ifdef ADC_DUAL_ADCS
+    DMAChannel  *_dmachannel_sync = nullptr; // ADC1 results, only allocated by initSynchronized
+#endif
 #endif
     DMAChannel  _dmachannel_adc;
 
@@ -48,32 +64,143 @@ public:
     AnalogBufferDMA(volatile uint16_t *buffer1, uint16_t buffer1_count, 
                     volatile uint16_t *buffer2 = nullptr, uint16_t buffer2_count = 0) :
             _buffer1(buffer1), _buffer1_count(buffer1_count), _buffer2(buffer2), _buffer2_count(buffer2_count) {};
+
+    // One region of region_count samples split in num_blocks blocks of the same size, filled in a circle.
+    // A consumer can fall behind up to num_blocks-1 blocks before losing data.
+    // More than ADC_DMA_MAX_SETTINGS blocks need one DMASetting per block in settings (not used by Teensy LC),
+    // they must stay valid as long as the object is used (for example a global array). Without them init
+    // sets ADC_ERROR::OTHER in the fail_flag and uses the whole region as one block.
+    // The timestamps of more than ADC_DMA_MAX_SETTINGS blocks are allocated here and freed by the destructor.
+    AnalogBufferDMA(volatile uint16_t *region, uint32_t region_count, uint16_t num_blocks, DMASetting *settings = nullptr);
+
+    // Stops the DMA and frees what the object allocated
+    ~AnalogBufferDMA();
+
+    // it owns the memory it allocates
+    AnalogBufferDMA(const AnalogBufferDMA &) = delete;
+    AnalogBufferDMA &operator=(const AnalogBufferDMA &) = delete;
     
     void init(ADC *adc, int8_t adc_num = -1);
 
+#ifndef KINETISL
+    // Like init, but converts the pins in turns: after each result is read a second DMA channel writes
+    // the next pin to SC1A (HC0 on Teensy 4), so buffer position k holds pins[k % num_pins].
+    // The first conversion is started here and it runs at full speed; on Teensy 3.x startPDB can be called
+    // afterwards to convert one pin per PDB period instead.
+    // All pins must use the same mux (a or b), buffer counts must be multiples of num_pins and blocks at most 511 samples.
+    // Returns false (and sets the fail_flag of the ADC) if the pins or buffers are not valid.
+    bool initScan(ADC *adc, int8_t adc_num, const uint8_t *pins, uint8_t num_pins);
+#endif
+
+#if defined(ADC_DUAL_ADCS) && !defined(KINETISL)
+    // Like init, but for ADC::startSynchronizedTimer: both ADCs write into the same buffer, even positions
+    // hold the results of ADC0 and odd ones those of ADC1 converted at the same time, so each block has
+    // count/2 pairs with one timestamp. Use the constructor with one buffer or the one with a region, the
+    // counts (and samplesPerInterrupt) must be even. Call it before ADC::startSynchronizedTimer.
+    // Returns false (and sets the fail_flag of ADC0) if the buffers are not valid.
+    bool initSynchronized(ADC *adc);
+#endif
+
+#ifdef ADC_USE_PDB
+    // Like init, but for ADC_Module::startPDBPingPong: samples alternate between RA and RB,
+    // so even positions of the buffers hold pinA and odd ones pinB. Buffer counts must be even.
+    void initPingPong(ADC *adc, int8_t adc_num = -1);
+#endif
+
+    // Interrupt every samples instead of once per buffer, call it before init.
+    // The buffer counts must be multiples of samples, and there can be at most ADC_DMA_MAX_SETTINGS blocks
+    // (half of a single buffer is always possible). 0 interrupts once per buffer.
+    inline void samplesPerInterrupt(uint16_t samples) {_block_samples = samples;}
+    inline uint32_t samplesPerInterrupt(void) {return _block_samples;}
+
     void stopOnCompletion(bool stop_on_complete);
     inline bool stopOnCompletion(void) {return _stop_on_completion;}
     bool clearCompletion();
-    inline volatile uint16_t *bufferLastISRFilled() {return (!_buffer2 || (_interrupt_count & 1))? _buffer1 : _buffer2;}
-    inline uint16_t bufferCountLastISRFilled() {return (!_buffer2 || (_interrupt_count & 1))? _buffer1_count : _buffer2_count;}
+    inline volatile uint16_t *bufferLastISRFilled() {return blockBuffer(_interrupt_count - 1);}
+    inline uint16_t bufferCountLastISRFilled() {return blockCount(_interrupt_count - 1);}
     inline uint32_t interruptCount() {return _interrupt_count;}
     inline uint32_t interruptDeltaTime() {return _interrupt_delta_time;}
     inline bool     interrupted() {return _interrupt_delta_time != 0;}
     inline void     clearInterrupt() {_interrupt_delta_time = 0;}
     inline void     userData(uint32_t new_data) {_user_data = new_data;}
     inline uint32_t userData(void) {return _user_data;}
+
+    // Single producer (DMA isr), single consumer access to the filled buffers (blocks), without disabling interrupts.
+    // Call readBlock to get the oldest block not yet processed, and commitBlock when done with it.
+    struct Block {
+      volatile uint16_t *buffer;
+      uint16_t count;
+      uint32_t sequence;  // number of the block since init, a gap means blocks were overwritten before being read
+      uint64_t timestamp; // cycleCount() when the block was completed (when its last sample was converted)
+      uint64_t first_sample; // number of samples converted since init before this block
+    };
+    // returns false if there's no new block, if some were overwritten it skips to the oldest valid one.
+    // On Teensy 4 the block is removed from the data cache if it's in DMAMEM, so it can be read directly
+    // (buffers and blocks in DMAMEM should be aligned to 32 bytes).
+    bool readBlock(Block &block);
+    // returns false if the block was (partially) overwritten while being processed
+    bool commitBlock();
+    // Call callback from the DMA isr with each completed block, it's committed when the callback returns.
+    // Don't use readBlock/commitBlock while a callback is attached, pass nullptr to detach it.
+    inline void attachBlockCallback(void (*callback)(AnalogBufferDMA *abdma, const Block &block)) {_block_callback = callback;}
+    // number of blocks overwritten before they were committed
+    inline uint32_t overrunCount() {return __atomic_load_n(&_overrun_count, __ATOMIC_RELAXED);}
+
+    // CPU cycles since the board started, extended to 64 bits, used to timestamp the blocks.
+    // On Teensy LC it's derived from micros().
+    static uint64_t cycleCount();
+    // sample rate in Hz measured from the timestamps of the blocks, 0 until two blocks are complete
+    float sampleRate();
 protected:
+    // number of blocks that can be completed but not yet committed without being overwritten.
+    // A single circular buffer starts being overwritten as soon as it's complete, so it's only best effort.
+    inline uint32_t blocksInFlight() {return (_num_blocks - 1 + _stop_on_completion)? (_num_blocks - 1 + _stop_on_completion) : 1;}
+    inline volatile uint16_t *blockBuffer(uint32_t sequence) {
+      uint32_t index = sequence % _num_blocks;
+      if (index < _num_blocks1) return _buffer1 + index * _block_samples;
+      return _buffer2 + (index - _num_blocks1) * _block_samples;
+    }
+    inline uint16_t blockCount(uint32_t sequence) {
+      if (_block_samples) return _block_samples;
+      return ((sequence % _num_blocks) < _num_blocks1)? _buffer1_count : _buffer2_count;
+    }
+    // number of samples converted since init before the block
+    inline uint64_t blockFirstSample(uint32_t sequence) {
+      uint32_t index = sequence % _num_blocks;
+      uint32_t offset = (index < _num_blocks1)? index * _block_samples : _buffer1_count + (index - _num_blocks1) * _block_samples;
+      if (!_block_samples) offset = index? _buffer1_count : 0;
+      return (uint64_t)(sequence / _num_blocks) * (_buffer1_count + (_buffer2? _buffer2_count : 0)) + offset;
+    }
 
     volatile uint32_t _interrupt_count = 0;
     volatile uint32_t _interrupt_delta_time;
     volatile uint32_t _last_isr_time;
 
     volatile uint16_t *_buffer1;
-    uint16_t _buffer1_count;
+    uint32_t _buffer1_count;
     volatile uint16_t *_buffer2;
-    uint16_t _buffer2_count;
+    uint32_t _buffer2_count;
     uint32_t  _user_data = 0;
     bool     _stop_on_completion = false;
+    uint32_t _block_samples = 0;            // samples per block, 0 is one block per buffer (a region can have big ones)
+    uint16_t _num_blocks = 1;               // blocks in both buffers
+    uint16_t _num_blocks1 = 1;              // blocks in the first buffer
+    uint16_t _num_settings = 0;             // DMASettings used, 0 if only the channel is used
+    uint16_t _max_blocks = ADC_DMA_MAX_SETTINGS; // max number of blocks (settings and timestamps available)
+    bool     _circular = false;             // region split in blocks, don't stop on completion
+    volatile uint32_t _read_sequence = 0;   // written by the consumer: next block to read
+    uint32_t _block_sequence = 0;           // block returned by readBlock
+    volatile uint32_t _overrun_count = 0;   // written by the producer
+    uint64_t _timestamps[ADC_DMA_MAX_SETTINGS];
+    uint64_t *_block_timestamp = _timestamps; // cycleCount() when each block was completed
+    uint64_t _first_timestamp = 0;          // cycleCount() when the first block was completed
+    void (*_block_callback)(AnalogBufferDMA *abdma, const Block &block) = nullptr;
+
+    static uint32_t _cycles_high;           // upper 32 bits of cycleCount()
+    static uint32_t _cycles_last;           // last value of the cycle counter, to detect overflows
+#ifndef KINETISL
+    uint32_t _scan_table[ADC_MAX_SCAN_PINS];  // SC1A/HC0 value written after each result
+#endif
 };
 
 #endif
@@ -47,11 +47,10 @@ namespace atomic
 {
     /////// Atomic bit set/clear
     /* Clear bit in address (make it zero), set bit (make it one), or return the value of that bit
-    *   changeBitFlag can change up to 2 bits in a flag at the same time
     *   We can change this functions depending on the board.
     *   Teensy 3.x use bitband while Teensy LC has a more advanced bit manipulation engine.
-    *   Teensy 4 also has bitband capabilities, but are not yet implemented, instead registers are 
-    *   set and cleared manually. TODO: fix this.
+    *   Teensy 4 has no bitband, it uses exclusive loads and stores (LDREX/STREX) so it doesn't need to disable
+    *   the interrupts, and changeBitFlag can change any number of bits with one store.
     */
     #if defined(KINETISK) // Teensy 3.x
     //! Bitband address
@@ -116,45 +115,67 @@ namespace atomic
 
 
     #elif defined(__IMXRT1062__) // Teensy 4
+    // exclusive load/store: the store fails if an interrupt (or anything else) touched the monitor
+    // after the load, so the read-modify-write is retried instead of disabling the interrupts.
+    // All ADC and ADC_ETC registers are 32 bits, but 16 and 8 bit registers work too.
+    __attribute__((always_inline)) inline uint32_t loadExclusive(volatile uint32_t& reg) {
+        uint32_t value;
+        asm volatile("ldrex %0, [%1]" : "=r" (value) : "r" (&reg) : "memory");
+        return value;
+    }
+    __attribute__((always_inline)) inline uint32_t storeExclusive(volatile uint32_t& reg, uint32_t value) {
+        uint32_t failed;
+        asm volatile("strex %0, %2, [%1]" : "=&r" (failed) : "r" (&reg), "r" (value) : "memory");
+        return failed;
+    }
+    __attribute__((always_inline)) inline uint16_t loadExclusive(volatile uint16_t& reg) {
+        uint32_t value;
+        asm volatile("ldrexh %0, [%1]" : "=r" (value) : "r" (&reg) : "memory");
+        return value;
+    }
+    __attribute__((always_inline)) inline uint32_t storeExclusive(volatile uint16_t& reg, uint16_t value) {
+        uint32_t failed;
+        asm volatile("strexh %0, %2, [%1]" : "=&r" (failed) : "r" (&reg), "r" ((uint32_t)value) : "memory");
+        return failed;
+    }
+    __attribute__((always_inline)) inline uint8_t loadExclusive(volatile uint8_t& reg) {
+        uint32_t value;
+        asm volatile("ldrexb %0, [%1]" : "=r" (value) : "r" (&reg) : "memory");
+        return value;
+    }
+    __attribute__((always_inline)) inline uint32_t storeExclusive(volatile uint8_t& reg, uint8_t value) {
+        uint32_t failed;
+        asm volatile("strexb %0, %2, [%1]" : "=&r" (failed) : "r" (&reg), "r" ((uint32_t)value) : "memory");
+        return failed;
+    }
+
+    //! Clear the bits in clear_mask and then set those in set_mask, with only one store
+    /** Any exception between the load and the store clears the monitor, so the store fails and it's retried:
+    *   an interrupt can't lose its own changes to the register, and the interrupts are never disabled.
+    */
+    template<typename T>
+    __attribute__((always_inline)) inline void modifyBits(volatile T& reg, T clear_mask, T set_mask) {
+        T value;
+        do {
+            value = (loadExclusive(reg) & ~clear_mask) | set_mask;
+        } while(storeExclusive(reg, value));
+    }
+
     template<typename T>
     __attribute__((always_inline)) inline void setBitFlag(volatile T& reg, T flag) {
-        __disable_irq();
-        reg |= flag;
-        __enable_irq();
+        modifyBits(reg, (T)0, flag);
     }
 
     template<typename T>
     __attribute__((always_inline)) inline void clearBitFlag(volatile T& reg, T flag) {
-        __disable_irq();
-        reg &= ~flag;
-        __enable_irq();
+        modifyBits(reg, flag, (T)0);
     }
 
     template<typename T>
     __attribute__((always_inline)) inline void changeBitFlag(volatile T& reg, T flag, T state) {
-        // flag can be 1 or 2 bits wide
-        // state can have one or two bits set
-        if(__builtin_popcount(flag) == 1) { // 1 bit
-            if (state) { 
-                setBitFlag(reg, flag);
-            } else {
-                clearBitFlag(reg, flag);
-            }        
-        } else { // 2 bits
-            // lsb first
-            if ((state >> __builtin_ctzl(flag))&0x1) { // lsb of state is 1
-                setBitFlag(reg, (uint32_t)(1 << __builtin_ctzl(flag)));
-            } else { // lsb is 0
-                clearBitFlag(reg, (uint32_t)(1 << __builtin_ctzl(flag)));
-            }
-            // msb
-            if ((state >> (31-__builtin_clzl(flag)))&0x1) { // msb of state is 1
-                setBitFlag(reg, (uint32_t)(1 << (31-__builtin_clzl(flag))));
-            } else { // msb is 0
-                clearBitFlag(reg, (uint32_t)(1 << (31-__builtin_clzl(flag))));
-            }
-        }
-        
+        // flag can have any number of bits, even if they aren't contiguous
+        // state has the new value of those bits (already shifted)
+        modifyBits(reg, flag, (T)(state & flag));
     }
 
     template<typename T>
@@ -0,0 +1,90 @@
+/* Example for using DMA with ADC and a deep ring of blocks
+    This example splits one large region in many blocks that the DMA fills in a circle, the loop
+    reads them with readBlock/commitBlock, so it can fall behind (for example while writing to an SD card)
+    for up to num_blocks-1 blocks without losing data.
+    Every block has a timestamp in CPU cycles and the number of its first sample, lost blocks show up
+    as gaps in the sequence numbers and in overrunCount().
+
+    It should work for Teensy LC, 3.x and T4
+*/
+
+#ifdef ADC_USE_DMA
+
+#include <ADC.h>
+#include <AnalogBufferDMA.h>
+
+const int readPin_adc_0 = A0;
+
+ADC *adc = new ADC(); // adc object
+
+#ifdef KINETISL
+const uint32_t block_size = 128;
+const uint16_t num_blocks = 4;
+#else
+const uint32_t block_size = 512;
+const uint16_t num_blocks = 32;
+#endif
+
+DMAMEM static volatile uint16_t __attribute__((aligned(32))) dma_adc_region[block_size * num_blocks];
+#ifndef KINETISL
+DMASetting dma_settings[num_blocks]; // one per block, needed for more than ADC_DMA_MAX_SETTINGS blocks
+AnalogBufferDMA abdma(dma_adc_region, block_size * num_blocks, num_blocks, dma_settings);
+#else
+AnalogBufferDMA abdma(dma_adc_region, block_size * num_blocks, num_blocks);
+#endif
+
+uint32_t next_sequence = 0;
+
+void setup() {
+    while (!Serial && millis() < 5000) ;
+
+    pinMode(LED_BUILTIN, OUTPUT);
+    pinMode(readPin_adc_0, INPUT);
+
+    Serial.begin(9600);
+    Serial.println("Setup ADC_0");
+
+    adc->adc0->setAveraging(8); // set number of averages
+    adc->adc0->setResolution(12); // set bits of resolution
+
+    abdma.init(adc, ADC_0);
+
+    // Start the dma operation..
+    adc->adc0->startContinuous(readPin_adc_0);
+
+    Serial.println("End Setup");
+}
+
+void loop() {
+    AnalogBufferDMA::Block block;
+
+    while (abdma.readBlock(block)) {
+        if (block.sequence != next_sequence) {
+            Serial.printf("Lost %u blocks\n", block.sequence - next_sequence);
+        }
+        next_sequence = block.sequence + 1;
+
+        uint32_t sum = 0;
+        for (uint16_t i = 0; i < block.count; i++) {
+            sum += block.buffer[i];
+        }
+
+        if (!abdma.commitBlock()) {
+            Serial.println("Block overwritten while processing it");
+        }
+
+        if ((block.sequence % num_blocks) == 0) {
+            Serial.printf("Block %u, first sample %u, cycles %u, average %u, rate %.1f Hz, overruns %u\n",
+                          block.sequence, (uint32_t)block.first_sample, (uint32_t)block.timestamp,
+                          sum / block.count, abdma.sampleRate(), abdma.overrunCount());
+        }
+    }
+
+    // simulate a slow consumer, the ring absorbs it
+    delay(5);
+}
+
+#else // make sure the example can run for any boards (automated testing)
+void setup() {}
+void loop() {}
+#endif // ADC_USE_DMA
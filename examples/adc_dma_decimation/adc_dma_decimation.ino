@@ -0,0 +1,71 @@
+/* Example for getting more bits of resolution by oversampling with DMA
+    The ADC runs as fast as it can without hardware averages and a CIC filter decimates the blocks
+    of the DMA by 64, so each output has 6 more bits than the conversions (12+6 = 18 bits, scaled
+    back to 16 bits here). The effective number of bits depends on the noise of the input.
+
+    It should work for Teensy LC, 3.x and T4
+*/
+
+#ifdef ADC_USE_DMA
+
+#include <ADC.h>
+#include <AnalogBufferDMA.h>
+#include <ADC_Decimator.h>
+
+const int readPin_adc_0 = A0;
+
+ADC *adc = new ADC(); // adc object
+
+const uint32_t block_size = 512;
+const uint16_t num_blocks = 4;
+
+DMAMEM static volatile uint16_t __attribute__((aligned(32))) dma_adc_region[block_size * num_blocks];
+AnalogBufferDMA abdma(dma_adc_region, block_size * num_blocks, num_blocks);
+
+// order 2, decimation 64 and 12 bit inputs: gain of 64^2, 12 extra bits in the sums (24 bits)
+ADC_CIC<2, 64, 12> cic;
+const uint8_t cic_shift = decltype(cic)::extraBits() - 4; // keep 16 bits: 12 from the ADC + 4 more
+
+uint32_t outputs[block_size / 64 + 1];
+
+void setup() {
+    while (!Serial && millis() < 5000) ;
+
+    pinMode(LED_BUILTIN, OUTPUT);
+    pinMode(readPin_adc_0, INPUT);
+
+    Serial.begin(9600);
+    Serial.println("Setup ADC_0");
+
+    adc->adc0->setAveraging(1); // no hardware averages, the filter does it
+    adc->adc0->setResolution(12); // set bits of resolution
+    adc->adc0->setConversionSpeed(ADC_CONVERSION_SPEED::HIGH_SPEED);
+    adc->adc0->setSamplingSpeed(ADC_SAMPLING_SPEED::HIGH_SPEED);
+
+    abdma.init(adc, ADC_0);
+
+    // Start the dma operation..
+    adc->adc0->startContinuous(readPin_adc_0);
+
+    Serial.println("End Setup");
+}
+
+void loop() {
+    AnalogBufferDMA::Block block;
+
+    while (abdma.readBlock(block)) {
+        uint32_t num_outputs = cic.process(block, outputs);
+        abdma.commitBlock();
+
+        if ((block.sequence % 64) == 0) {
+            Serial.printf("Block %u: %u outputs at %.1f Hz, last %u (16 bits) = ", block.sequence, num_outputs,
+                          abdma.sampleRate() / 64, outputs[num_outputs - 1] >> cic_shift);
+            Serial.println((outputs[num_outputs - 1] >> cic_shift) * 3.3 / 65535, 5);
+        }
+    }
+}
+
+#else // make sure the example can run for any boards (automated testing)
+void setup() {}
+void loop() {}
+#endif // ADC_USE_DMA
@@ -0,0 +1,88 @@
+/* Example for streaming both ADCs at the same time with DMA
+    One timer (PDB in Teensy 3.x, QuadTimer in Teensy 4) starts a conversion in both ADCs at the same time,
+    and the DMA stores the results in one buffer as {adc0, adc1} pairs, so both values of a pair were
+    measured at the same instant and each block has one timestamp.
+    This is useful to measure two related signals, like the voltage and the current of a load.
+
+    It should work for Teensy 3.1, 3.5, 3.6 and T4 (boards with two ADCs)
+*/
+
+#if defined(ADC_USE_DMA) && defined(ADC_DUAL_ADCS) && defined(ADC_USE_TIMER)
+
+#include <ADC.h>
+#include <AnalogBufferDMA.h>
+
+#if defined(KINETISK)
+const int readPin_adc_0 = A0;
+const int readPin_adc_1 = A2;
+#else
+const int readPin_adc_0 = A0;
+const int readPin_adc_1 = 26;
+#endif
+
+const uint32_t sample_frequency = 20000; // pairs per second
+
+ADC *adc = new ADC(); // adc object
+
+const uint32_t block_pairs = 256;
+const uint16_t num_blocks = 4;
+
+// two values (adc0, adc1) per pair
+DMAMEM static volatile uint16_t __attribute__((aligned(32))) dma_adc_region[2 * block_pairs * num_blocks];
+AnalogBufferDMA abdma(dma_adc_region, 2 * block_pairs * num_blocks, num_blocks);
+
+void setup() {
+    while (!Serial && millis() < 5000) ;
+
+    pinMode(LED_BUILTIN, OUTPUT);
+    pinMode(readPin_adc_0, INPUT);
+    pinMode(readPin_adc_1, INPUT);
+
+    Serial.begin(9600);
+    Serial.println("Setup both ADCs");
+
+    // use the same settings in both ADCs so they finish at the same time
+    adc->adc0->setAveraging(4);
+    adc->adc0->setResolution(12);
+    adc->adc1->setAveraging(4);
+    adc->adc1->setResolution(12);
+
+    if (!abdma.initSynchronized(adc)) {
+        Serial.println("Wrong buffers");
+    }
+
+    // Start the conversions, the DMA does the rest
+    if (!adc->startSynchronizedTimer(readPin_adc_0, readPin_adc_1, sample_frequency)) {
+        Serial.println("Could not start the timer");
+    }
+
+    Serial.println("End Setup");
+}
+
+void loop() {
+    AnalogBufferDMA::Block block;
+
+    while (abdma.readBlock(block)) {
+        // mean of the product, like the active power of a load
+        int32_t sum0 = 0, sum1 = 0;
+        float sum_product = 0;
+        for (uint16_t i = 0; i < block.count; i += 2) {
+            sum0 += block.buffer[i];
+            sum1 += block.buffer[i + 1];
+            sum_product += (float)block.buffer[i] * block.buffer[i + 1];
+        }
+        abdma.commitBlock();
+
+        uint16_t pairs = block.count / 2;
+        Serial.printf("Block %u at cycle %u: adc0 %d, adc1 %d, product %.0f, rate %.1f Hz, overruns %u\n",
+                      block.sequence, (uint32_t)block.timestamp, sum0 / pairs, sum1 / pairs,
+                      sum_product / pairs, abdma.sampleRate() / 2, abdma.overrunCount());
+    }
+
+    delay(10);
+}
+
+#else // make sure the example can run for any boards (automated testing)
+void setup() {}
+void loop() {}
+#endif
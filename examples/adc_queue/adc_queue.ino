@@ -0,0 +1,76 @@
+/* Example for sharing an ADC between several tasks with the conversion queue
+    Each task submits the pins it needs and continues with its work, the ADC interrupt converts
+    them one after the other and calls each task's callback with the result.
+    Nothing waits for the conversions in the loop.
+
+    It should work for Teensy LC, 3.x and T4
+*/
+
+#include <ADC.h>
+
+const int temperature_pin = A0;
+const int battery_pin = A1;
+const int light_pin = A2;
+
+ADC *adc = new ADC(); // adc object
+
+// every task has its own state, passed to the callback as the context
+struct Task {
+    const char *name;
+    volatile int value;
+    volatile bool ready;
+};
+
+Task temperature_task = {"temperature", 0, false};
+Task battery_task = {"battery", 0, false};
+Task light_task = {"light", 0, false};
+
+// called inside the ADC interrupt, keep it short
+void conversionDone(int value, void *context) {
+    Task *task = (Task*)context;
+    task->value = value;
+    task->ready = true;
+}
+
+elapsedMillis since_battery;
+elapsedMillis since_print;
+
+void setup() {
+    pinMode(LED_BUILTIN, OUTPUT);
+    pinMode(temperature_pin, INPUT);
+    pinMode(battery_pin, INPUT);
+    pinMode(light_pin, INPUT);
+
+    Serial.begin(9600);
+
+    adc->adc0->setAveraging(16);
+    adc->adc0->setResolution(12);
+}
+
+void loop() {
+    // the temperature and light tasks want a value as often as possible
+    if (temperature_task.ready || (adc->adc0->getQueueLength() == 0)) {
+        temperature_task.ready = false;
+        adc->adc0->submit(temperature_pin, conversionDone, &temperature_task);
+        light_task.ready = false;
+        adc->adc0->submit(light_pin, conversionDone, &light_task);
+    }
+
+    // the battery is checked once per second
+    if (since_battery > 1000) {
+        since_battery = 0;
+        battery_task.ready = false;
+        if (!adc->adc0->submit(battery_pin, conversionDone, &battery_task)) {
+            Serial.println("Queue full");
+        }
+    }
+
+    if (since_print > 500) {
+        since_print = 0;
+        Serial.printf("%s: %d, %s: %d, %s: %d\n", temperature_task.name, temperature_task.value,
+                      light_task.name, light_task.value, battery_task.name, battery_task.value);
+        digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN));
+    }
+
+    // other work here
+}
@@ -0,0 +1,98 @@
+/* Example for scanning several pins with one timer trigger
+    Valid for Teensy 4.
+
+    Each tick of the QuadTimer converts all the pins in readPins one after the other using
+    the trigger chain of the ADC_ETC, without any help from the CPU.
+    The interrupt is called once per tick, after the last pin has been converted.
+
+    Example usage:
+        Start the scan at some frequency: s 1000<cr>
+        Print the last values of all pins: v<cr>
+        Stop the scan: s<cr>
+*/
+
+#if defined(__IMXRT1062__)
+
+#include <ADC.h>
+#include <ADC_util.h>
+
+const uint8_t readPins[] = {A0, A1, A2, A3, A4, A5, A6, A7}; // all valid for ADC0
+const uint8_t num_pins = sizeof(readPins);
+
+ADC *adc = new ADC(); // adc object;
+
+volatile uint16_t values[ADC_ETC_MAX_CHAIN];
+volatile uint32_t num_scans = 0;
+
+void setup() {
+
+  pinMode(LED_BUILTIN, OUTPUT);
+  for (uint8_t i = 0; i < num_pins; i++) {
+    pinMode(readPins[i], INPUT);
+  }
+
+  Serial.begin(9600);
+  while (!Serial && millis() < 5000) ; // wait up to 5 seconds for serial monitor.
+
+  Serial.println("Begin setup");
+
+  adc->adc0->setAveraging(1); // set number of averages
+  adc->adc0->setResolution(12); // set bits of resolution
+  adc->adc0->setConversionSpeed(ADC_CONVERSION_SPEED::HIGH_SPEED); // change the conversion speed
+  adc->adc0->setSamplingSpeed(ADC_SAMPLING_SPEED::HIGH_SPEED); // change the sampling speed
+
+  Serial.println("End setup");
+
+  Serial.println("Enter a command such as: s 1000<cr> to start scanning");
+}
+
+char c = 0;
+
+void loop() {
+
+  if (Serial.available()) {
+    c = Serial.read();
+    if (c == 'v') { // values
+      Serial.printf("Scans: %u\n", num_scans);
+      for (uint8_t i = 0; i < num_pins; i++) {
+        Serial.printf("Pin %d: %d = ", readPins[i], values[i]);
+        Serial.println(values[i] * 3.3 / adc->adc0->getMaxValue(), DEC);
+      }
+    } else if (c == 's') { // start scan, before pressing enter write the frequency in Hz
+      uint32_t freq = Serial.parseInt();
+      adc->adc0->stopTimer();
+      if (freq == 0) {
+        Serial.println("Stop scan.");
+      } else {
+        Serial.printf("Scan %d pins at %d Hz.\n", num_pins, freq);
+        adc->adc0->enableInterrupts(adc0_isr);
+        if (!adc->adc0->startQuadTimerChain(readPins, num_pins, freq)) {
+          Serial.println("Could not start the scan.");
+        }
+      }
+    }
+  }
+
+  // Print errors, if any.
+  if (adc->adc0->fail_flag != ADC_ERROR::CLEAR) {
+    Serial.print("ADC0: "); Serial.println(getStringADCError(adc->adc0->fail_flag));
+    adc->adc0->resetError();
+  }
+
+  delay(100);
+}
+
+// called once per scan, after the last pin has been converted
+void adc0_isr() {
+  for (uint8_t i = 0; i < num_pins; i++) {
+    values[i] = adc->adc0->readQuadTimerChain(i);
+  }
+  num_scans++;
+  digitalWriteFast(LED_BUILTIN, !digitalReadFast(LED_BUILTIN) );
+  asm("DSB");
+}
+
+#else // make sure the example can run for any boards (automated testing)
+void setup() {}
+void loop() {}
+#endif // Teensy 4
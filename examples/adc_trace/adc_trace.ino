@@ -0,0 +1,63 @@
+/* Example for logging what the ADC does and sending the log over Serial
+    Uncomment #define ADC_TRACE in ADC_Trace.h first.
+    Every 100 ms it reads two pins, one of them with a comparison, and interrupts a continuous conversion.
+    Send a 'd' to get the records in binary (see ADC_Trace::dump for the format) and decode them
+    with a small script in the computer, or send an 's' to see how many records there are.
+
+    It should work for Teensy LC, 3.x and T4
+*/
+
+#include <ADC.h>
+
+#ifdef ADC_TRACE
+
+const int readPin = A0;
+const int comparePin = A1;
+const int continuousPin = A2;
+
+ADC *adc = new ADC(); // adc object
+
+elapsedMillis since_read;
+
+void setup() {
+    pinMode(readPin, INPUT);
+    pinMode(comparePin, INPUT);
+    pinMode(continuousPin, INPUT);
+
+    Serial.begin(9600);
+
+    adc->adc0->setAveraging(4);
+    adc->adc0->setResolution(12);
+}
+
+void loop() {
+    if (since_read > 100) {
+        since_read = 0;
+        adc->adc0->analogRead(readPin);
+
+        // the comparison fails if the value is lower than half the range
+        adc->adc0->enableCompare(adc->adc0->getMaxValue() / 2, 1);
+        adc->adc0->analogRead(comparePin);
+        adc->adc0->disableCompare();
+
+        // this read interrupts the continuous conversion and restarts it
+        adc->adc0->startContinuous(continuousPin);
+        adc->adc0->analogRead(readPin);
+        adc->adc0->stopContinuous();
+    }
+
+    if (Serial.available()) {
+        const char command = Serial.read();
+        if (command == 'd') {
+            ADC_Trace::dump(Serial);
+        } else if (command == 's') {
+            Serial.printf("%lu records, %lu lost\n", (unsigned long)ADC_Trace::available(),
+                          (unsigned long)ADC_Trace::lost());
+        }
+    }
+}
+
+#else // make sure the example can run for any boards (automated testing)
+void setup() {}
+void loop() {}
+#endif // ADC_TRACE
@@ -12,8 +12,7 @@
     When the measurement is done, the adc_isr is executed:
         - If you have more than one timer per ADC module you need to know which pin was measured.
         - Then you store/process the data
-        - Finally, if you have more than one timer you can check whether the last measurement interruped a
-          a previous one (using adc->adcX->adcWasInUse), and restart it if so.
+        - If the last measurement interrupted a previous one (adc->adcX->adcWasInUse), readSingle() restarts it.
           The settings of the interrupted measurement are stored in the adc->adcX->adc_config struct.
 
 
@@ -220,14 +219,6 @@ void adc0_isr() {
         adc->readSingle();
     }
 
-    // restore ADC config if it was in use before being interrupted by the analog timer
-    if (adc->adc0->adcWasInUse) {
-        // restore ADC config, and restart conversion
-        adc->adc0->loadConfig(&adc->adc0->adc_config);
-        // avoid a conversion started by this isr to repeat itself
-        adc->adc0->adcWasInUse = false;
-    }
-
 
     //digitalWriteFast(ledPin+2, !digitalReadFast(ledPin+2));
 
@@ -0,0 +1,78 @@
+/* Example for saving the calibration in the EEPROM
+    After a reset the calibration is loaded from the EEPROM instead of calibrating the ADC again,
+    so the first measurement is ready sooner. The first time (or when the board or the clocks change)
+    the ADC calibrates the two profiles used here and saves them.
+    Once in a while the calibration is checked again, if it changed too much (temperature, supply) it's saved again.
+
+    It should work for Teensy LC, 3.x and T4
+*/
+
+#include <ADC.h>
+
+const int readPin = A0;
+
+const int calibration_address = 0; // first byte of the EEPROM to use
+
+ADC *adc = new ADC(); // adc object
+
+elapsedMillis since_check;
+
+// fast and low resolution
+void setFastProfile() {
+    adc->adc0->setAveraging(1);
+    adc->adc0->setResolution(8);
+    adc->adc0->setConversionSpeed(ADC_CONVERSION_SPEED::HIGH_SPEED);
+}
+
+// slow and precise
+void setPreciseProfile() {
+    adc->adc0->setAveraging(32);
+    adc->adc0->setResolution(12);
+    adc->adc0->setConversionSpeed(ADC_CONVERSION_SPEED::LOW_SPEED);
+}
+
+void setup() {
+    // load it as soon as possible, it stops the calibration that started with the ADC object
+    bool loaded = adc->loadCalibration(calibration_address);
+
+    pinMode(LED_BUILTIN, OUTPUT);
+    pinMode(readPin, INPUT);
+
+    Serial.begin(9600);
+    while (!Serial && millis() < 5000) ;
+
+    if (loaded) {
+        Serial.println("Calibration loaded from the EEPROM");
+    } else {
+        Serial.println("No valid calibration in the EEPROM, calibrating");
+        // each profile is calibrated the first time it's used (analogRead waits for it)
+        setFastProfile();
+        adc->adc0->analogRead(readPin);
+        setPreciseProfile();
+        adc->adc0->analogRead(readPin);
+        adc->saveCalibration(calibration_address);
+    }
+}
+
+void loop() {
+    // switching profiles restores the cached calibration, there's no need to wait for a new one
+    setFastProfile();
+    int fast_value = adc->adc0->analogRead(readPin);
+    setPreciseProfile();
+    int precise_value = adc->adc0->analogRead(readPin);
+
+    Serial.printf("Fast: %d, precise: %d\n", fast_value, precise_value);
+
+    if (since_check > 60000) {
+        since_check = 0;
+        adc->adc0->startCalibrationCheck(); // checks the precise profile
+        if (adc->adc0->calibrationDrifted()) {
+            Serial.println("The calibration changed, saving it again");
+            setFastProfile();
+            adc->adc0->analogRead(readPin); // the fast profile was cleared from the cache, calibrate it
+            adc->saveCalibration(calibration_address);
+        }
+    }
+
+    delay(500);
+}
@@ -0,0 +1,48 @@
+/* Example for measuring how long the ADC library keeps the interrupts disabled
+    Uncomment #define ADC_IRQ_STATS in ADC_IRQStats.h first.
+    Every second it prints, for each place of the library that disables the interrupts, how many times it did,
+    the longest time and a histogram of the times in CPU cycles (bin i counts 2^i to 2^(i+1)-1 cycles).
+    That's the worst-case delay the library adds to the other interrupts.
+
+    It should work for Teensy LC, 3.x and T4
+*/
+
+#include <ADC.h>
+
+#ifdef ADC_IRQ_STATS
+
+const int readPin = A0;
+
+ADC *adc = new ADC(); // adc object
+
+elapsedMillis since_print;
+
+void setup() {
+    pinMode(readPin, INPUT);
+
+    Serial.begin(9600);
+    while (!Serial && millis() < 5000) ;
+
+    adc->adc0->setAveraging(4);
+    adc->adc0->setResolution(12);
+}
+
+void loop() {
+    // some work for the library
+    adc->adc0->analogRead(readPin);
+    ADC_Module::AsyncRead read = adc->adc0->startRead(readPin);
+    read.get();
+
+    if (since_print > 1000) {
+        since_print = 0;
+        Serial.printf("Longest time with the interrupts disabled: %lu cycles (%.2f us)\n",
+                      (unsigned long)ADC_IRQStats::maxCycles(), ADC_IRQStats::maxCycles() * 1e6 / F_CPU);
+        ADC_IRQStats::print(Serial);
+        Serial.println();
+    }
+}
+
+#else // make sure the example can run for any boards (automated testing)
+void setup() {}
+void loop() {}
+#endif // ADC_IRQ_STATS
@@ -131,6 +131,11 @@ namespace ADC_settings {
     #define ADC_USE_TIMER
 #endif
 
+// Max number of conversions started by one trigger of the ADC_ETC (see ADC_Module::startQuadTimerChain)
+#if defined(ADC_TEENSY_4) // Teensy 4
+        #define ADC_ETC_MAX_CHAIN (8)
+#endif
+
 // Has internal reference?
 #if defined(ADC_TEENSY_3_1) // Teensy 3.1
         #define ADC_USE_INTERNAL_VREF
@@ -535,6 +540,15 @@ enum class ADC_SAMPLING_SPEED : uint8_t {
     #endif
 };
 
+/*! Priority of a read or of a stream of conversions (continuous mode, hardware trigger or DMA).
+*   A read interrupts a stream only if its priority is higher, see ADC_Module::setStreamPriority().
+*/
+enum class ADC_PRIORITY : uint8_t {
+    BACKGROUND, /*!< default for streams: any read interrupts them. */
+    NORMAL, /*!< default for reads. */
+    URGENT, /*!< for reads that must always happen, like safety checks. Streams with this priority are never interrupted. */
+};
+
 
 
 // Mask for the channel selection in ADCx_SC1A,
@@ -579,6 +593,7 @@ namespace ADC_Error {
         COMPARISON          = 1<<7, /*!< Error during the comparison. */
         WRONG_ADC           = 1<<8, /*!< A non-existent ADC module was selected. */
         SYNCH               = 1<<9, /*!< Error during a synchronized measurement. */
+        PREEMPT             = 1<<10, /*!< A read didn't interrupt a stream with the same or higher priority. */
 
         CLEAR               = 0,    /*!< No error. */
     };
@@ -613,4 +628,56 @@ namespace ADC_Error {
 
 }
 
+//! \cond internal
+// Interrupt state and CPU cycle counter, used by the library, ADC_Trace and ADC_IRQStats
+namespace ADC_Cpu {
+
+    // are the interrupts enabled? (PRIMASK clear)
+    __attribute__((always_inline)) inline bool irqEnabled() {
+        uint32_t primask;
+        asm volatile("mrs %0, primask" : "=r" (primask));
+        return !primask;
+    }
+
+    // disables the interrupts and returns whether they were enabled, pass it to restoreIRQ.
+    // It can be called where they are already disabled, restoreIRQ won't enable them there.
+    __attribute__((always_inline)) inline bool disableIRQ() {
+        const bool enabled = irqEnabled();
+        __disable_irq();
+        return enabled;
+    }
+    __attribute__((always_inline)) inline void restoreIRQ(bool enabled) {
+        if (enabled) {
+            __enable_irq();
+        }
+    }
+
+    // enables the cycle counter: Teensy 4 starts it at boot, Teensy 3.x doesn't and Teensy LC uses the SysTick
+    inline void beginCycles() {
+        #if defined(KINETISK)
+        ARM_DEMCR |= ARM_DEMCR_TRCENA;
+        ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+        #endif
+    }
+
+    // CPU cycles, wrapping at 32 bits. Call it with the interrupts disabled:
+    // Teensy LC has no cycle counter, it uses millis and the SysTick (it counts down at F_CPU and restarts every ms),
+    // if the SysTick restarted its interrupt hasn't counted that ms yet.
+    __attribute__((always_inline)) inline uint32_t cycles() {
+        #if defined(KINETISL)
+        uint32_t count = systick_millis_count;
+        const uint32_t current = SYST_CVR;
+        // a pending SysTick with a current value not close to 0 means it restarted before reading it (like micros())
+        if ((SCB_ICSR & SCB_ICSR_PENDSTSET) && (current > 50)) {
+            count++;
+        }
+        return count*(SYST_RVR + 1) + (SYST_RVR - current);
+        #else
+        return ARM_DWT_CYCCNT;
+        #endif
+    }
+
+}
+//! \endcond
+
 #endif // ADC_SETTINGS_H
\ No newline at end of file